@@ -0,0 +1,366 @@
+#include "../src/expressions/expressions.hpp"
+#include "../src/parser/Lexer.hpp"
+#include "../src/tape/Incremental.hpp"
+#include "../src/tape/Jacobian.hpp"
+#include "../src/tape/Tape.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using VariableType = std::unordered_map<std::string, long double>;
+
+struct Config {
+	std::uint64_t seed = 42;
+	int count = 200;
+	int size = 64;
+	int depth = 12;
+	int vars = 4;
+	int repeat = 5;
+};
+
+// Random expressions of about `size` nodes and at most `depth` levels over `vars` variables
+class ExpressionGenerator {
+public:
+	ExpressionGenerator(const Config &config)
+		: rng(config.seed), max_depth(config.depth) {
+		for (int i = 0; i < config.vars; i++) variables.push_back(variable_name(i));
+	}
+
+	std::string generate(int size) {
+		return node(size, 0);
+	}
+
+	const std::vector<std::string> &variable_names() const {
+		return variables;
+	}
+
+private:
+	std::mt19937_64 rng;
+	int max_depth;
+	std::vector<std::string> variables;
+
+	// "va", "vb", ..., "vz", "vba", ...: letters only, and never a function name or "i"
+	static std::string variable_name(int index) {
+		std::string suffix;
+		do {
+			suffix.insert(suffix.begin(), char('a' + index % 26));
+			index /= 26;
+		} while (index > 0);
+		return "v" + suffix;
+	}
+
+	int uniform(int lo, int hi) {
+		return std::uniform_int_distribution<int>(lo, hi)(rng);
+	}
+
+	std::string number() {
+		std::string value = std::to_string(uniform(1, 9));
+		if (uniform(0, 1)) value += "." + std::to_string(uniform(1, 9));
+		return value;
+	}
+
+	std::string leaf() {
+		if (uniform(0, 9) < 7) return variables[uniform(0, int(variables.size()) - 1)];
+		return number();
+	}
+
+	std::string node(int budget, int depth) {
+		if (budget <= 1 || depth >= max_depth) return leaf();
+
+		if (uniform(0, 4) == 0) {
+			static const char *functions[] = {"sin", "cos", "ln", "exp"};
+			return std::string(functions[uniform(0, 3)]) + "(" + node(budget - 1, depth + 1) + ")";
+		}
+
+		static const char operators[] = {'+', '-', '*', '/', '^'};
+		const char op = operators[uniform(0, 4)];
+		if (op == '^') {
+			// Small constant exponents keep the values finite
+			return "(" + node(budget - 2, depth + 1) + ") ^ " + std::to_string(uniform(2, 3));
+		}
+		const int lhs_budget = uniform(1, budget - 1);
+		return "(" + node(lhs_budget, depth + 1) + " " + op + " " +
+			   node(budget - 1 - lhs_budget, depth + 1) + ")";
+	}
+};
+
+struct PhaseResult {
+	std::string phase;
+	std::uint64_t ops = 0;
+	std::uint64_t items = 0;
+	double total_ns = 0;
+};
+
+// `ops` and `items` (tokens, nodes, characters...) are per round; only `body` is timed
+template <typename Body>
+PhaseResult measure(
+	const std::string &phase, int repeat, std::uint64_t ops, std::uint64_t items, Body body
+) {
+	PhaseResult result{phase};
+	for (int r = 0; r < repeat; r++) {
+		auto start = std::chrono::steady_clock::now();
+		body();
+		auto end = std::chrono::steady_clock::now();
+		result.total_ns += std::chrono::duration<double, std::nano>(end - start).count();
+		result.ops += ops;
+		result.items += items;
+	}
+	return result;
+}
+
+// Printed expressions must parse back to the same tree, so they evaluate to exactly the same
+// value; every variable gets its own value so that a lost pair of parentheses shows
+void check_round_trip(const std::vector<Expression<>> &expressions, const std::vector<std::string> &variables) {
+	VariableType point;
+	for (std::size_t i = 0; i < variables.size(); i++) point[variables[i]] = 0.5L + 0.25L * i;
+	for (const auto &expression : expressions) {
+		const std::string printed = expression.to_string();
+		const Expression<> reparsed = Expression<>::from_string(printed);
+		const long double expected = expression.compile().evaluate(point);
+		const long double actual = reparsed.compile().evaluate(point);
+		const bool same_value = actual == expected || (std::isnan(actual) && std::isnan(expected));
+		if (reparsed.to_string() != printed || !same_value)
+			throw std::runtime_error("Printed expression does not parse back: " + printed);
+	}
+}
+
+Config parse_config(int argc, char* argv[]) {
+	Config config;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (++i >= argc)
+			throw std::invalid_argument("No value specified for " + arg);
+		const std::string value = argv[i];
+		if (arg == "--seed") {
+			config.seed = std::stoull(value);
+		} else if (arg == "--count") {
+			config.count = std::stoi(value);
+		} else if (arg == "--size") {
+			config.size = std::stoi(value);
+		} else if (arg == "--depth") {
+			config.depth = std::stoi(value);
+		} else if (arg == "--vars") {
+			config.vars = std::max(1, std::stoi(value));
+		} else if (arg == "--repeat") {
+			config.repeat = std::max(1, std::stoi(value));
+		} else {
+			throw std::invalid_argument("Unknown argument: " + arg);
+		}
+	}
+	return config;
+}
+
+int main(int argc, char* argv[]) {
+	const Config config = parse_config(argc, argv);
+
+	ExpressionGenerator generator(config);
+	std::vector<std::string> sources;
+	for (int i = 0; i < config.count; i++) sources.push_back(generator.generate(config.size));
+
+	VariableType values;
+	for (const auto &name : generator.variable_names()) values[name] = 0.75L;
+	const std::string &diff_by = generator.variable_names().front();
+
+	std::vector<Expression<>> expressions;
+	std::vector<Expression<>> derivatives;
+	for (const auto &source : sources) expressions.push_back(Expression<>::from_string(source));
+	for (const auto &expression : expressions) derivatives.push_back(expression.diff(diff_by));
+	check_round_trip(expressions, generator.variable_names());
+
+	std::uint64_t tokens = 0, nodes = 0, derivative_nodes = 0, chars = 0;
+	for (const auto &source : sources) {
+		Lexer<RealNumber> lexer(source);
+		while (lexer.next_token().type != EOL) tokens++;
+	}
+	for (const auto &expression : expressions) nodes += expression.compile().size();
+	for (const auto &derivative : derivatives) {
+		derivative_nodes += derivative.compile().size();
+		chars += derivative.to_string().size();
+	}
+	const std::uint64_t count = sources.size();
+
+	// Finite results are folded into a checksum so that no phase can be optimized away
+	long double checksum = 0;
+	auto accumulate = [&](long double value) {
+		if (std::isfinite(value)) checksum += value;
+	};
+	std::vector<PhaseResult> results;
+
+	results.push_back(measure("lex", config.repeat, count, tokens, [&] {
+		for (const auto &source : sources) {
+			Lexer<RealNumber> lexer(source);
+			while (lexer.next_token().type != EOL) {}
+		}
+	}));
+
+	results.push_back(measure("parse", config.repeat, count, nodes, [&] {
+		for (const auto &source : sources) Expression<>::from_string(source);
+	}));
+	// The same with every node allocated from a fresh arena per round, freed in bulk at its end.
+	// Nodes are interned per arena, so here every node is built anew, while "parse" above finds
+	// the nodes of `expressions` already interned on the heap
+	ArenaStats arena_stats{};
+	results.push_back(measure("parse_arena", config.repeat, count, nodes, [&] {
+		const auto arena = std::make_shared<NodeArena>();
+		ArenaScope scope(arena);
+		for (const auto &source : sources) Expression<>::from_string(source);
+		arena_stats = arena->stats();
+	}));
+
+	// Binary images of the same expressions, to compare loading them against parsing the text
+	std::vector<std::string> images;
+	std::uint64_t text_bytes = 0, binary_bytes = 0;
+	for (std::size_t i = 0; i < expressions.size(); i++) {
+		std::ostringstream image;
+		expressions[i].compile().serialize(image);
+		images.push_back(std::move(image).str());
+		text_bytes += sources[i].size();
+		binary_bytes += images.back().size();
+	}
+	results.push_back(measure("load_binary", config.repeat, count, nodes, [&] {
+		for (const auto &image : images) {
+			const auto *data = reinterpret_cast<const std::byte *>(image.data());
+			Expression<>::from_compiled(CompiledExpression<>::deserialize({data, image.size()}));
+		}
+	}));
+
+	results.push_back(measure("diff", config.repeat, count, derivative_nodes, [&] {
+		for (const auto &expression : expressions) expression.diff(diff_by);
+	}));
+
+	results.push_back(measure("eval", config.repeat, count, nodes, [&] {
+		for (const auto &expression : expressions) accumulate(expression.resolve_with(values));
+	}));
+
+	std::vector<CompiledExpression<>> compiled;
+	for (const auto &expression : expressions) compiled.push_back(expression.compile());
+	results.push_back(measure("eval_compiled", config.repeat, count, nodes, [&] {
+		for (auto &tape : compiled) accumulate(tape.evaluate(values));
+	}));
+
+	// Changing one variable between evaluations, the typical step of a parameter sweep
+	std::vector<IncrementalEvaluator<>> incremental;
+	for (const auto &tape : compiled) {
+		incremental.emplace_back(tape);
+		incremental.back().evaluate(values);
+	}
+	long double step = 0.75L;
+	results.push_back(measure("eval_incremental", config.repeat, count, nodes, [&] {
+		step = step == 0.75L ? 0.5L : 0.75L;
+		for (auto &evaluator : incremental) {
+			if (evaluator.variables().empty()) continue;
+			accumulate(evaluator.set(0, step));
+		}
+	}));
+
+	// The same tapes at the narrower precisions the CLI can select
+	std::vector<CompiledExpression<double>> compiled_double;
+	std::vector<CompiledExpression<float>> compiled_float;
+	for (const auto &tape : compiled) {
+		compiled_double.push_back(tape.convert<double>());
+		compiled_float.push_back(tape.convert<float>());
+	}
+	std::unordered_map<std::string, double> double_values(values.begin(), values.end());
+	std::unordered_map<std::string, float> float_values(values.begin(), values.end());
+	results.push_back(measure("eval_compiled_double", config.repeat, count, nodes, [&] {
+		for (auto &tape : compiled_double) accumulate(tape.evaluate(double_values));
+	}));
+	results.push_back(measure("eval_compiled_float", config.repeat, count, nodes, [&] {
+		for (auto &tape : compiled_float) accumulate(tape.evaluate(float_values));
+	}));
+
+	// A sweep of complex points through every expression, as interleaved std::complex values and
+	// as split real and imaginary columns in double and in float
+	constexpr std::size_t sweep = 1024;
+	std::vector<CompiledExpression<ComplexNumber>> compiled_complex;
+	for (const auto &source : sources)
+		compiled_complex.push_back(Expression<ComplexNumber>::from_string(source).compile());
+	std::vector<ComplexNumber> complex_column(sweep);
+	std::vector<double> real_column(sweep), imag_column(sweep);
+	std::vector<float> real_column_float(sweep), imag_column_float(sweep);
+	for (std::size_t i = 0; i < sweep; i++) {
+		real_column[i] = 0.75;
+		imag_column[i] = double(i) / sweep;
+		real_column_float[i] = float(real_column[i]);
+		imag_column_float[i] = float(imag_column[i]);
+		complex_column[i] = {real_column[i], imag_column[i]};
+	}
+	std::vector<ComplexNumber> complex_out(sweep);
+	results.push_back(measure("eval_batch_complex", config.repeat, count, nodes * sweep, [&] {
+		for (auto &tape : compiled_complex) {
+			const std::vector<std::span<const ComplexNumber>> columns(tape.variables().size(), complex_column);
+			tape.evaluate_batch(columns, complex_out);
+			accumulate(complex_out.back().real());
+		}
+	}));
+	std::vector<double> real_out(sweep), imag_out(sweep);
+	results.push_back(measure("eval_batch_complex_split", config.repeat, count, nodes * sweep, [&] {
+		for (auto &tape : compiled_complex) {
+			const std::vector<std::span<const double>> real_columns(tape.variables().size(), real_column);
+			const std::vector<std::span<const double>> imag_columns(tape.variables().size(), imag_column);
+			tape.evaluate_batch_split<double>(real_columns, imag_columns, real_out, imag_out);
+			accumulate(real_out.back());
+		}
+	}));
+	std::vector<float> real_out_float(sweep), imag_out_float(sweep);
+	results.push_back(measure("eval_batch_complex_split_float", config.repeat, count, nodes * sweep, [&] {
+		for (auto &tape : compiled_complex) {
+			const std::vector<std::span<const float>> real_columns(tape.variables().size(), real_column_float);
+			const std::vector<std::span<const float>> imag_columns(tape.variables().size(), imag_column_float);
+			tape.evaluate_batch_split<float>(real_columns, imag_columns, real_out_float, imag_out_float);
+			accumulate(real_out_float.back());
+		}
+	}));
+
+	// All expressions as one vector function: the whole Jacobian built jointly, and evaluated in one pass
+	const std::vector<std::string> &jacobian_variables = generator.variable_names();
+	results.push_back(measure("jacobian_build", config.repeat, count, nodes, [&] {
+		accumulate(Jacobian<>(expressions, jacobian_variables).nonzeros());
+	}));
+	Jacobian<> jacobian(expressions, jacobian_variables);
+	std::vector<long double> jacobian_inputs;
+	for (const auto &name : jacobian.inputs()) jacobian_inputs.push_back(values.at(name));
+	std::vector<long double> jacobian_out(jacobian.nonzeros());
+	results.push_back(measure("jacobian_eval", config.repeat, count, nodes, [&] {
+		jacobian.evaluate(jacobian_inputs, jacobian_out);
+		if (!jacobian_out.empty()) accumulate(jacobian_out.back());
+	}));
+
+	results.push_back(measure("print", config.repeat, count, chars, [&] {
+		for (const auto &derivative : derivatives) accumulate(derivative.to_string().size());
+	}));
+
+	std::cout << "{\n";
+	std::cout << "  \"config\": {\"seed\": " << config.seed << ", \"count\": " << config.count
+			  << ", \"size\": " << config.size << ", \"depth\": " << config.depth
+			  << ", \"vars\": " << config.vars << ", \"repeat\": " << config.repeat << "},\n";
+	std::cout << "  \"phases\": [\n";
+	for (std::size_t i = 0; i < results.size(); i++) {
+		const auto &result = results[i];
+		std::cout << "    {\"phase\": \"" << result.phase << "\", \"ops\": " << result.ops
+				  << ", \"items\": " << result.items << ", \"total_ns\": " << std::uint64_t(result.total_ns)
+				  << ", \"ns_per_op\": " << result.total_ns / double(result.ops)
+				  << ", \"ns_per_item\": " << result.total_ns / double(std::max<std::uint64_t>(1, result.items))
+				  << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	std::cout << "  ],\n";
+	std::cout << "  \"sizes\": {\"text_bytes\": " << text_bytes << ", \"binary_bytes\": " << binary_bytes
+			  << "},\n";
+	std::cout << "  \"arena\": {\"nodes\": " << arena_stats.nodes << ", \"bytes_used\": " << arena_stats.bytes_used
+			  << ", \"bytes_reserved\": " << arena_stats.bytes_reserved << ", \"blocks\": " << arena_stats.blocks
+			  << ", \"bytes_per_node\": " << arena_stats.bytes_per_node() << "},\n";
+	std::cout << "  \"checksum\": ";
+	if (std::isfinite(double(checksum))) std::cout << double(checksum) << "\n";
+	else std::cout << "null\n";
+	std::cout << "}\n";
+	return 0;
+}
@@ -0,0 +1,71 @@
+#include "../src/expressions/expressions.hpp"
+#include "../src/tape/Tape.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Number of nodes the expression would have if every shared subtree was copied
+template <typename T>
+std::uint64_t tree_size(const CompiledExpression<T> &compiled) {
+	const auto &code = compiled.instructions();
+	std::vector<std::uint64_t> size(code.size());
+	for (std::size_t i = 0; i < code.size(); i++) {
+		switch (code[i].op) {
+		case OpCode::Const:
+		case OpCode::Var:
+			size[i] = 1;
+			break;
+		case OpCode::Sin:
+		case OpCode::Cos:
+		case OpCode::Ln:
+		case OpCode::Exp:
+			size[i] = 1 + size[code[i].lhs];
+			break;
+		default:
+			size[i] = 1 + size[code[i].lhs] + size[code[i].rhs];
+		}
+	}
+	return size.back();
+}
+
+int main(int argc, char* argv[]) {
+	std::string expression_string = "x^3 * sin(x) / (1 + exp(x))", diff_by = "x";
+	int max_order = 6;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (++i >= argc)
+			throw std::invalid_argument("No value specified for " + arg);
+		if (arg == "--expr") {
+			expression_string = argv[i];
+		} else if (arg == "--by") {
+			diff_by = argv[i];
+		} else if (arg == "--order") {
+			max_order = std::stoi(argv[i]);
+		} else {
+			throw std::invalid_argument("Unknown argument: " + arg);
+		}
+	}
+
+	auto raw = Expression<>::from_string(expression_string);
+	auto simplified = raw.simplify();
+	DiffCache<RealNumber> cache;
+
+	std::cout << "order\traw_tree\traw_dag\tsimplified_tree\tsimplified_dag\n";
+	for (int order = 0; order <= max_order; order++) {
+		if (order > 0) {
+			raw = raw.diff(diff_by, cache, false);
+			simplified = simplified.diff(diff_by, cache);
+		}
+		const auto raw_compiled = raw.compile();
+		const auto simplified_compiled = simplified.compile();
+		std::cout << order << "\t" << tree_size(raw_compiled) << "\t"
+				  << raw_compiled.size() << "\t"
+				  << tree_size(simplified_compiled) << "\t"
+				  << simplified_compiled.size() << "\n";
+	}
+	return 0;
+}
@@ -0,0 +1,185 @@
+#include "Native.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+template<typename T>
+constexpr const char* TYPE_NAME = nullptr;
+
+template<>
+constexpr const char* TYPE_NAME<RealNumber> = "long double";
+
+template<>
+constexpr const char* TYPE_NAME<double> = "double";
+
+template<>
+constexpr const char* TYPE_NAME<float> = "float";
+
+template<>
+constexpr const char* TYPE_NAME<ComplexNumber> = "std::complex<long double>";
+
+template<typename Real>
+constexpr const char* LITERAL_SUFFIX = "";
+
+template<>
+constexpr const char* LITERAL_SUFFIX<RealNumber> = "L";
+
+template<>
+constexpr const char* LITERAL_SUFFIX<float> = "f";
+
+// Exact literals: hexadecimal floats, with non-finite values spelled through numeric_limits
+template<typename Real>
+void write_literal(std::ostream& out, const Real value) {
+    if (std::isnan(value)) {
+        out << "std::numeric_limits<" << TYPE_NAME<Real> << ">::quiet_NaN()";
+    } else if (std::isinf(value)) {
+        out << (value < 0 ? "-" : "") << "std::numeric_limits<" << TYPE_NAME<Real> << ">::infinity()";
+    } else {
+        out << std::hexfloat << value << std::defaultfloat << LITERAL_SUFFIX<Real>;
+    }
+}
+
+void write_literal(std::ostream& out, const ComplexNumber value) {
+    out << TYPE_NAME<ComplexNumber> << "(";
+    write_literal(out, value.real());
+    out << ", ";
+    write_literal(out, value.imag());
+    out << ")";
+}
+
+const char* function_name(const OpCode op) {
+    switch (op) {
+    case OpCode::Pow:
+        return "std::pow";
+    case OpCode::Sin:
+        return "std::sin";
+    case OpCode::Cos:
+        return "std::cos";
+    case OpCode::Ln:
+        return "std::log";
+    case OpCode::Exp:
+        return "std::exp";
+    default:
+        return nullptr;
+    }
+}
+
+const char* operator_sign(const OpCode op) {
+    switch (op) {
+    case OpCode::Add:
+        return " + ";
+    case OpCode::Sub:
+        return " - ";
+    case OpCode::Mul:
+        return " * ";
+    case OpCode::Div:
+        return " / ";
+    default:
+        return nullptr;
+    }
+}
+
+// One `const T r<i> = ...;` line per instruction; `variable(slot)` spells the read of a variable
+template<typename T, typename VariableRead>
+void write_body(
+    std::ostream& out,
+    const CompiledExpression<T>& tape,
+    const std::vector<std::uint32_t>& slots,
+    const char* indent,
+    VariableRead variable
+) {
+    const std::vector<Instruction>& code = tape.instructions();
+    for (std::size_t i = 0; i < code.size(); ++i) {
+        const Instruction& instr = code[i];
+        out << indent << "const T r" << i << " = ";
+        switch (instr.op) {
+        case OpCode::Const:
+            write_literal(out, tape.constants()[instr.lhs]);
+            break;
+        case OpCode::Var:
+            out << variable(slots[instr.lhs]);
+            break;
+        case OpCode::Add:
+        case OpCode::Sub:
+        case OpCode::Mul:
+        case OpCode::Div:
+            out << "r" << instr.lhs << operator_sign(instr.op) << "r" << instr.rhs;
+            break;
+        case OpCode::Pow:
+            out << function_name(instr.op) << "(r" << instr.lhs << ", r" << instr.rhs << ")";
+            break;
+        case OpCode::Sin:
+        case OpCode::Cos:
+        case OpCode::Ln:
+        case OpCode::Exp:
+            out << function_name(instr.op) << "(r" << instr.lhs << ")";
+            break;
+        }
+        out << ";\n";
+    }
+}
+
+}  // namespace
+
+template<typename T>
+CodeGenerator<T>::CodeGenerator(std::vector<std::string> variables) : variable_names(std::move(variables)) {}
+
+template<typename T>
+void CodeGenerator<T>::add(const std::string& symbol, const CompiledExpression<T>& tape) {
+    // Map the tape's own variable slots onto the generator's
+    std::vector<std::uint32_t> slots;
+    for (const std::string& name : tape.variables()) {
+        const auto it = std::find(variable_names.begin(), variable_names.end(), name);
+        if (it == variable_names.end()) {
+            throw std::invalid_argument(std::format("Variable \"{}\" is not bound", name));
+        }
+        slots.push_back(static_cast<std::uint32_t>(it - variable_names.begin()));
+    }
+    const std::size_t result = tape.size() - 1;
+
+    std::ostringstream out;
+    out << "extern \"C\" void " << symbol << "(const T* values, T* out) {\n";
+    write_body(out, tape, slots, "    ", [](const std::uint32_t slot) {
+        return "values[" + std::to_string(slot) + "]";
+    });
+    out << "    *out = r" << result << ";\n";
+    out << "}\n\n";
+
+    out << "extern \"C\" void " << symbol << "_batch(const T* const* columns, T* out, std::size_t rows) {\n";
+    out << "    for (std::size_t row = 0; row < rows; ++row) {\n";
+    write_body(out, tape, slots, "        ", [](const std::uint32_t slot) {
+        return "columns[" + std::to_string(slot) + "][row]";
+    });
+    out << "        out[row] = r" << result << ";\n";
+    out << "    }\n";
+    out << "}\n\n";
+
+    functions += out.str();
+}
+
+template<typename T>
+std::string CodeGenerator<T>::source() const {
+    std::ostringstream out;
+    out << "// Generated by symbolic-differentiation; variables:";
+    for (const std::string& name : variable_names) {
+        out << " " << name;
+    }
+    out << "\n";
+    out << "#include <cmath>\n";
+    out << "#include <complex>\n";
+    out << "#include <cstddef>\n";
+    out << "#include <limits>\n\n";
+    out << "using T = " << TYPE_NAME<T> << ";\n\n";
+    out << functions;
+    return out.str();
+}
+
+template class CodeGenerator<RealNumber>;
+template class CodeGenerator<double>;
+template class CodeGenerator<float>;
+template class CodeGenerator<ComplexNumber>;
@@ -0,0 +1,88 @@
+#ifndef NATIVE_HPP
+#define NATIVE_HPP
+
+#include "../expressions/expressions.hpp"
+#include "../tape/Tape.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+/// Emits C++ source for compiled expressions: every function becomes an `extern "C"` scalar kernel
+/// `void <symbol>(const T* values, T* out)` and a batch kernel
+/// `void <symbol>_batch(const T* const* columns, T* out, std::size_t rows)`,
+/// both reading variables in the order given to the generator.
+template<typename T = RealNumber>
+class CodeGenerator {
+public:
+    explicit CodeGenerator(std::vector<std::string> variables);
+
+    void add(const std::string& symbol, const CompiledExpression<T>& tape);
+    std::string source() const;
+
+private:
+    std::vector<std::string> variable_names;
+    std::string functions;
+};
+
+struct NativeOptions {
+    std::string compiler = "c++";
+    std::string flags = "-O2";
+    /// Where compiled libraries are kept between runs; empty for "symbolic-differentiation/kernels" under
+    /// $XDG_CACHE_HOME or ~/.cache. The directory is created with mode 0700, and libraries are only
+    /// loaded from it while it and they are owned by the current user and not writable by anyone else.
+    std::filesystem::path cache_dir;
+};
+
+/// A kernel pair loaded from a native library. Keeps the library loaded while it is alive.
+template<typename T = RealNumber>
+class NativeFunction {
+public:
+    using ScalarKernel = void (*)(const T* values, T* out);
+    using BatchKernel = void (*)(const T* const* columns, T* out, std::size_t rows);
+
+    T evaluate(std::span<const T> values) const;
+    /// Evaluates every row of `columns` (one column per variable, in `NativeModule::variables()` order).
+    void evaluate_batch(std::span<const std::span<const T>> columns, std::span<T> out) const;
+
+private:
+    std::shared_ptr<void> library;
+    ScalarKernel scalar = nullptr;
+    BatchKernel batch = nullptr;
+    std::size_t variable_count = 0;
+
+    template<typename> friend class NativeModule;
+};
+
+/// An expression and its first derivatives compiled to machine code with the system compiler.
+/// Libraries are cached on disk under a hash of their source and compiler command, with the source
+/// and command kept next to them to tell collisions apart, so an expression is only compiled once
+/// per cache directory.
+template<typename T = RealNumber>
+class NativeModule {
+public:
+    static NativeModule build(
+        const Expression<T>& expression,
+        const std::vector<std::string>& derivatives_by = {},
+        const NativeOptions& options = {}
+    );
+
+    const NativeFunction<T>& function() const;
+    /// Throws if `by` was not among the `derivatives_by` passed to `build`.
+    const NativeFunction<T>& derivative(const std::string& by) const;
+
+    const std::vector<std::string>& variables() const;
+    const std::filesystem::path& library_path() const;
+
+private:
+    std::vector<std::string> variable_names;
+    std::vector<std::string> derivative_names;
+    std::vector<NativeFunction<T>> functions;
+    std::filesystem::path path;
+
+    NativeModule() = default;
+};
+
+#endif  // NATIVE_HPP
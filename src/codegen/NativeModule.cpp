@@ -0,0 +1,316 @@
+#include "Native.hpp"
+#include "../io/Hash.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Key files that differ from the one being built before giving up
+constexpr std::size_t MAX_SLOTS = 16;
+
+std::string quoted(const std::filesystem::path& path) {
+    // Single quotes keep the shell from interpreting anything but a single quote, which is spliced in
+    std::string result = "'";
+    for (const char c : path.string()) {
+        if (c == '\'') {
+            result += "'\\''";
+        } else {
+            result += c;
+        }
+    }
+    return result + "'";
+}
+
+std::string read_file(const std::filesystem::path& path) {
+    std::ifstream in(path);
+    std::ostringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+// Libraries are loaded into the process, so everything they are read from must be private to the
+// current user: a file or directory anyone else can write to could have been planted or replaced
+void check_private(const std::filesystem::path& path, const struct stat& status, const bool directory) {
+    if (directory ? !S_ISDIR(status.st_mode) : !S_ISREG(status.st_mode)) {
+        throw std::runtime_error(std::format(
+            "Refusing to use \"{}\": not a {}", path.string(), directory ? "directory" : "regular file"
+        ));
+    }
+    if (status.st_uid != ::geteuid()) {
+        throw std::runtime_error(std::format("Refusing to use \"{}\": owned by another user", path.string()));
+    }
+    if ((status.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+        throw std::runtime_error(std::format(
+            "Refusing to use \"{}\": writable by group or others", path.string()
+        ));
+    }
+}
+
+void check_private(const std::filesystem::path& path, const bool directory) {
+    struct stat status;
+    if (::lstat(path.c_str(), &status) != 0) {
+        throw std::runtime_error(std::format("Can not stat \"{}\": {}", path.string(), std::strerror(errno)));
+    }
+    check_private(path, status, directory);
+}
+
+// $XDG_CACHE_HOME, or ~/.cache, as the XDG base directory specification has it
+std::filesystem::path default_cache_dir() {
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg != nullptr && xdg[0] == '/') {
+        return std::filesystem::path(xdg) / "symbolic-differentiation" / "kernels";
+    }
+    const char* home = std::getenv("HOME");
+    if (home == nullptr || home[0] != '/') {
+        throw std::runtime_error(
+            "Can not find a cache directory for native kernels: set HOME, XDG_CACHE_HOME or NativeOptions::cache_dir"
+        );
+    }
+    return std::filesystem::path(home) / ".cache" / "symbolic-differentiation" / "kernels";
+}
+
+// Creates the cache directory with mode 0700 if it is missing, and checks that it is private
+void prepare_cache_dir(const std::filesystem::path& dir) {
+    std::filesystem::create_directories(dir.parent_path());
+    if (::mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) {
+        throw std::runtime_error(std::format("Can not create \"{}\": {}", dir.string(), std::strerror(errno)));
+    }
+    check_private(dir, true);
+}
+
+enum class Slot {
+    Claimed,  // the key file was created by this call
+    Matches,  // the key file holds this key
+    Taken     // the key file holds another key: a hash collision, or a build that never finished
+};
+
+// The key file of a slot names what its library is built from. Creating it exclusively claims the
+// slot, and a slot is never rebuilt from another key, so a library always matches its key file
+Slot claim_slot(const std::filesystem::path& key_path, const std::string& key) {
+    int fd = ::open(key_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW, 0600);
+    if (fd >= 0) {
+        const bool written = ::write(fd, key.data(), key.size()) == static_cast<ssize_t>(key.size());
+        ::close(fd);
+        if (!written) {
+            throw std::runtime_error(std::format("Can not write \"{}\"", key_path.string()));
+        }
+        return Slot::Claimed;
+    }
+    if (errno != EEXIST) {
+        throw std::runtime_error(std::format("Can not create \"{}\": {}", key_path.string(), std::strerror(errno)));
+    }
+
+    fd = ::open(key_path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd < 0) {
+        throw std::runtime_error(std::format("Can not open \"{}\": {}", key_path.string(), std::strerror(errno)));
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0) {
+        ::close(fd);
+        throw std::runtime_error(std::format("Can not stat \"{}\": {}", key_path.string(), std::strerror(errno)));
+    }
+    try {
+        check_private(key_path, status, false);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    std::string stored;
+    if (static_cast<std::size_t>(status.st_size) == key.size()) {
+        stored.resize(key.size());
+        std::size_t done = 0;
+        while (done < stored.size()) {
+            const ssize_t count = ::read(fd, stored.data() + done, stored.size() - done);
+            if (count <= 0) {
+                break;
+            }
+            done += static_cast<std::size_t>(count);
+        }
+        stored.resize(done);
+    }
+    ::close(fd);
+    return stored == key ? Slot::Matches : Slot::Taken;
+}
+
+// Builds `path` from `source`. Every build works on files of its own and publishes the library
+// with a rename, so concurrent builds of the same source are safe.
+void compile_library(const std::string& source, const std::filesystem::path& path, const NativeOptions& options) {
+    static std::atomic<std::uint64_t> build_counter = 0;
+    const std::string unique = std::to_string(::getpid()) + "." + std::to_string(build_counter++);
+
+    std::filesystem::path source_path = path;
+    source_path.replace_extension(unique + ".cpp");
+    std::filesystem::path temp_path = path;
+    temp_path.replace_extension(unique + ".so.tmp");
+    std::filesystem::path log_path = path;
+    log_path.replace_extension(unique + ".log");
+
+    std::ofstream(source_path) << source;
+    const std::string command = options.compiler + " " + options.flags + " -std=c++17 -shared -fPIC -o " +
+        quoted(temp_path) + " " + quoted(source_path) + " 2> " + quoted(log_path);
+    const int status = std::system(command.c_str());
+
+    const std::string log = read_file(log_path);
+    std::error_code ignored;
+    std::filesystem::remove(source_path, ignored);
+    std::filesystem::remove(log_path, ignored);
+    if (status != 0) {
+        std::filesystem::remove(temp_path, ignored);
+        throw std::runtime_error(std::format("Can not compile native kernels with \"{}\": {}", options.compiler, log));
+    }
+    // The compiler honours the umask, which may leave the library writable by the group
+    std::filesystem::permissions(temp_path, std::filesystem::perms::owner_all);
+    std::filesystem::rename(temp_path, path);
+}
+
+std::shared_ptr<void> open_library(const std::filesystem::path& path) {
+    void* handle = ::dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (handle == nullptr) {
+        throw std::runtime_error(std::format("Can not load native kernels: {}", ::dlerror()));
+    }
+    return std::shared_ptr<void>(handle, [](void* library) { ::dlclose(library); });
+}
+
+void* find_symbol(const std::shared_ptr<void>& library, const std::string& symbol) {
+    void* address = ::dlsym(library.get(), symbol.c_str());
+    if (address == nullptr) {
+        throw std::runtime_error(std::format("Native kernel \"{}\" is missing", symbol));
+    }
+    return address;
+}
+
+}  // namespace
+
+template<typename T>
+T NativeFunction<T>::evaluate(std::span<const T> values) const {
+    if (values.size() < variable_count) {
+        throw std::invalid_argument(std::format(
+            "Expected {} variable values, got {}", variable_count, values.size()
+        ));
+    }
+    T result;
+    scalar(values.data(), &result);
+    return result;
+}
+
+template<typename T>
+void NativeFunction<T>::evaluate_batch(std::span<const std::span<const T>> columns, std::span<T> out) const {
+    if (columns.size() < variable_count) {
+        throw std::invalid_argument(std::format(
+            "Expected {} variable columns, got {}", variable_count, columns.size()
+        ));
+    }
+    std::vector<const T*> column_data(variable_count);
+    for (std::size_t slot = 0; slot < variable_count; ++slot) {
+        if (columns[slot].size() < out.size()) {
+            throw std::invalid_argument(std::format("Column {} is shorter than the output", slot));
+        }
+        column_data[slot] = columns[slot].data();
+    }
+    batch(column_data.data(), out.data(), out.size());
+}
+
+template<typename T>
+NativeModule<T> NativeModule<T>::build(
+    const Expression<T>& expression,
+    const std::vector<std::string>& derivatives_by,
+    const NativeOptions& options
+) {
+    NativeModule module;
+    const CompiledExpression<T> compiled = expression.compile();
+    module.variable_names = compiled.variables();
+    module.derivative_names = derivatives_by;
+
+    CodeGenerator<T> generator(module.variable_names);
+    generator.add("kernel_0", compiled);
+    DiffCache<T> cache;
+    for (std::size_t i = 0; i < derivatives_by.size(); ++i) {
+        generator.add(std::format("kernel_{}", i + 1), expression.diff(derivatives_by[i], cache).compile());
+    }
+    const std::string source = generator.source();
+
+    const std::filesystem::path cache_dir = options.cache_dir.empty() ? default_cache_dir() : options.cache_dir;
+    prepare_cache_dir(cache_dir);
+
+    // The compiler command is part of the key: other flags make another library. The file name
+    // only comes from a hash of the key, so the key itself is kept next to the library and
+    // compared before it is reused; on a collision the next slot is tried
+    const std::string key = options.compiler + " " + options.flags + "\n" + source;
+    const std::string name = "kernel_" + hex_digest(fnv1a_hash(key));
+    for (std::size_t slot = 0;; ++slot) {
+        if (slot == MAX_SLOTS) {
+            throw std::runtime_error(std::format(
+                "Native kernel cache \"{}\" has no free slot for \"{}\"", cache_dir.string(), name
+            ));
+        }
+        const std::string stem = slot == 0 ? name : std::format("{}_{}", name, slot);
+        const Slot state = claim_slot(cache_dir / (stem + ".key"), key);
+        if (state == Slot::Taken) {
+            continue;
+        }
+        module.path = cache_dir / (stem + ".so");
+        if (state == Slot::Claimed || !std::filesystem::exists(module.path)) {
+            compile_library(source, module.path, options);
+        }
+        break;
+    }
+
+    check_private(module.path, false);
+    const std::shared_ptr<void> library = open_library(module.path);
+
+    for (std::size_t i = 0; i <= derivatives_by.size(); ++i) {
+        const std::string symbol = std::format("kernel_{}", i);
+        NativeFunction<T> function;
+        function.library = library;
+        function.scalar = reinterpret_cast<typename NativeFunction<T>::ScalarKernel>(find_symbol(library, symbol));
+        function.batch = reinterpret_cast<typename NativeFunction<T>::BatchKernel>(find_symbol(library, symbol + "_batch"));
+        function.variable_count = module.variable_names.size();
+        module.functions.push_back(std::move(function));
+    }
+    return module;
+}
+
+template<typename T>
+const NativeFunction<T>& NativeModule<T>::function() const {
+    return functions.front();
+}
+
+template<typename T>
+const NativeFunction<T>& NativeModule<T>::derivative(const std::string& by) const {
+    const auto it = std::find(derivative_names.begin(), derivative_names.end(), by);
+    if (it == derivative_names.end()) {
+        throw std::invalid_argument(std::format("No native derivative by \"{}\" was built", by));
+    }
+    return functions[it - derivative_names.begin() + 1];
+}
+
+template<typename T>
+const std::vector<std::string>& NativeModule<T>::variables() const {
+    return variable_names;
+}
+
+template<typename T>
+const std::filesystem::path& NativeModule<T>::library_path() const {
+    return path;
+}
+
+template class NativeFunction<RealNumber>;
+template class NativeFunction<double>;
+template class NativeFunction<float>;
+template class NativeFunction<ComplexNumber>;
+template class NativeModule<RealNumber>;
+template class NativeModule<double>;
+template class NativeModule<float>;
+template class NativeModule<ComplexNumber>;
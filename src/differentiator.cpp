@@ -1,59 +1,407 @@
 #include "expressions/expressions.hpp"
+#include "io/DiskCache.hpp"
+#include "tape/Precision.hpp"
+#include "tape/Tape.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <regex>
+#include <span>
+#include <sstream>
 #include <stdexcept>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 using VariableType = std::unordered_map<std::string, long double>;
 using ComplexVariableType =
 	std::unordered_map<std::string, std::complex<long double>>;
 
+struct Task {
+	std::string expression_string, diff_by;
+	// Set by --eval-file and --diff-file: the expression is read from this file instead
+	std::string expression_path;
+	bool eval_expr = false, diff_expr = false;
+	// With --complex the expression may use the imaginary unit `i` and is
+	// evaluated with `complex_variables`
+	bool complex = false;
+	VariableType variables;
+	ComplexVariableType complex_variables;
+};
+
+template <typename T>
+constexpr Precision PRECISION_OF = Precision::LongDouble;
+template <>
+constexpr Precision PRECISION_OF<double> = Precision::Double;
+template <>
+constexpr Precision PRECISION_OF<float> = Precision::Float;
+
+// Version of the printed text the cache holds; bump it whenever printing changes, so that
+// entries written by an older printer are never served. 2: parenthesized equal-precedence operands,
+// 3: signed zero constants
+constexpr std::string_view PRINTED_FORMAT = "printed-v3";
+
+// Derivatives are keyed by the printed format, the binary form of the parsed expression, which does
+// not depend on its spelling, the variable and the precision constants were folded in
+template <typename T>
+std::string cache_key(const Expression<T> &expr, const std::string &diff_by) {
+	std::ostringstream key;
+	key << PRINTED_FORMAT << '\0';
+	expr.compile().serialize(key);
+	key << '\0' << diff_by << '\0' << precision_name(PRECISION_OF<T>);
+	return std::move(key).str();
+}
+
+// Results are streamed to `out`, so huge derivatives are never held as one string
+// unless they go to the cache
 template <typename T, typename VarMap>
-std::string run_task(
+void run_task(
 	Expression<T> expr, bool to_diff, bool to_eval,
-	const std::string &diff_by, VarMap &values
+	const std::string &diff_by, VarMap &values, std::ostream &out,
+	DiskCache *cache
 ) {
-	std::stringstream oss;
 	if (to_diff) {
-		Expression<T> diff_expr = expr.diff(diff_by);
-		oss << "Differentiated: " << diff_expr.to_string();
+		out << "Differentiated: ";
+		if (cache) {
+			const std::string key = cache_key(expr, diff_by);
+			if (auto cached = cache->lookup(key)) {
+				out << *cached;
+			} else {
+				const std::string printed = expr.diff(diff_by).to_string();
+				cache->store(key, printed);
+				out << printed;
+			}
+		} else {
+			expr.diff(diff_by).print(out);
+		}
 	}
 
-	if (to_eval) oss << "Evaluated: " << expr.resolve_with(values);
-	return oss.str();
+	if (to_eval) out << "Evaluated: " << expr.resolve_with(values);
+}
+
+// Files are memory-mapped and parsed in place, so huge formulas are never copied
+template <typename T>
+Expression<T> parse_expression(const Task &task) {
+	if (!task.expression_path.empty())
+		return Expression<T>::from_file(task.expression_path);
+	return Expression<T>::from_string(task.expression_string);
+}
+
+// Complex values are written as `re`, `(re,im)` or a constant expression such as `1.5+2i`
+ComplexNumber parse_complex_value(const std::string &text) {
+	std::istringstream stream(text);
+	ComplexNumber value;
+	if (stream >> value && stream.peek() == std::char_traits<char>::eof()) return value;
+	ComplexVariableType no_variables;
+	return Expression<ComplexNumber>::from_string(text).resolve_with(no_variables);
 }
-int main(int argc, char* argv[]) {
-	std::string expression_string, diff_by;
-	bool eval_expr = false, diff_expr = false, use_complex = false;
-	VariableType variables;
-	ComplexVariableType complex_variables;
 
-	for (int i = 1; i < argc; i++) {
-		std::string arg = argv[i];
+Task parse_task(const std::vector<std::string> &args) {
+	Task task;
+	std::vector<std::pair<std::string, std::string>> assignments;
+	for (std::size_t i = 0; i < args.size(); i++) {
+		const std::string &arg = args[i];
 		if (arg == "--eval" || arg == "--diff") {
-			if (++i >= argc)
+			if (++i >= args.size())
 				throw std::invalid_argument("No value specified for " + arg);
-			expression_string = argv[i];
-			diff_expr |= (arg == "--diff");
-			eval_expr |= (arg == "--eval");
+			task.expression_string = args[i];
+			task.diff_expr |= (arg == "--diff");
+			task.eval_expr |= (arg == "--eval");
+		} else if (arg == "--eval-file" || arg == "--diff-file") {
+			if (++i >= args.size())
+				throw std::invalid_argument("No value specified for " + arg);
+			task.expression_path = args[i];
+			task.diff_expr |= (arg == "--diff-file");
+			task.eval_expr |= (arg == "--eval-file");
 		} else if (arg == "--by") {
-			if (++i >= argc)
+			if (++i >= args.size())
 				throw std::invalid_argument("No value specified for --by");
-			diff_by = argv[i];
+			task.diff_by = args[i];
+		} else if (arg == "--complex") {
+			task.complex = true;
 		} else if (arg.find("=") != std::string::npos) {
 			auto pos = arg.find("=");
-			std::string var_name = arg.substr(0, pos),
-						val_str = arg.substr(pos + 1);
-			variables[var_name] = std::stold(val_str);
+			assignments.emplace_back(arg.substr(0, pos), arg.substr(pos + 1));
 		} else {
 			throw std::invalid_argument("Unknown argument: " + arg);
 		}
 	}
+	for (const auto &[var_name, val_str] : assignments) {
+		if (task.complex) task.complex_variables[var_name] = parse_complex_value(val_str);
+		else task.variables[var_name] = std::stold(val_str);
+	}
+	return task;
+}
+
+// Options of the number type, valid in single and batch runs:
+//   --precision long|double|float|auto   type expressions are parsed and evaluated in
+//   --tolerance ERROR                    largest error against long double that auto accepts
+struct PrecisionOptions {
+	Precision precision = Precision::LongDouble;
+	bool automatic = false;
+	long double tolerance = 1e-9;
+};
+
+PrecisionOptions take_precision_options(std::vector<std::string> &args) {
+	PrecisionOptions options;
+	std::vector<std::string> rest;
+	for (std::size_t i = 0; i < args.size(); i++) {
+		if (args[i] == "--precision" || args[i] == "--tolerance") {
+			if (i + 1 >= args.size())
+				throw std::invalid_argument("No value specified for " + args[i]);
+			if (args[i] == "--tolerance") options.tolerance = std::stold(args[i + 1]);
+			else if (args[i + 1] == "auto") options.automatic = true;
+			else options.precision = parse_precision(args[i + 1]);
+			i++;
+		} else {
+			rest.push_back(args[i]);
+		}
+	}
+	args = std::move(rest);
+	return options;
+}
+
+// Samples the expression around the task's point: every variable is moved by up to 0.1% of
+// its magnitude, along a different deterministic sequence per variable
+PrecisionChoice choose_task_precision(const Task &task, long double tolerance) {
+	// Derivatives are printed, not evaluated, so they keep every digit of their constants
+	if (!task.eval_expr || task.complex) return {Precision::LongDouble, 0, 0};
+
+	constexpr std::size_t samples = 64;
+	const auto tape = parse_expression<long double>(task).compile();
+	std::vector<std::vector<long double>> storage;
+	std::vector<std::span<const long double>> columns;
+	storage.reserve(tape.variables().size());
+	for (std::size_t slot = 0; slot < tape.variables().size(); slot++) {
+		const std::string &name = tape.variables()[slot];
+		const auto it = task.variables.find(name);
+		if (it == task.variables.end())
+			throw std::runtime_error("Can not resolve variable \"" + name + "\"");
+		std::vector<long double> &column = storage.emplace_back(samples);
+		for (std::size_t k = 0; k < samples; k++) {
+			const long double offset =
+				(long double)(k * (2 * slot + 1) * 37 % samples) / (samples - 1) * 2 - 1;
+			column[k] = it->second + (std::abs(it->second) + 1) * 1e-3L * offset;
+		}
+		columns.emplace_back(column);
+	}
+	return choose_precision(tape, columns, tolerance);
+}
 
-	auto expression = Expression<>::from_string(expression_string);
-	std::cout << run_task(
-	    expression, diff_expr, eval_expr, diff_by, variables
-	) << "\n";
+template <typename T>
+void run_as(Task &task, std::ostream &out, DiskCache *cache) {
+	auto expression = parse_expression<T>(task);
+	std::unordered_map<std::string, T> values;
+	for (const auto &[name, value] : task.variables) values[name] = T(value);
+	run_task(
+		expression, task.diff_expr, task.eval_expr, task.diff_by, values, out,
+		cache
+	);
+}
+
+void run(
+	Task &task, std::ostream &out, DiskCache *cache,
+	const PrecisionOptions &options
+) {
+	if (task.complex) {
+		if (options.precision != Precision::LongDouble)
+			throw std::invalid_argument("Complex expressions are evaluated in long double only");
+		auto expression = parse_expression<ComplexNumber>(task);
+		run_task(
+			expression, task.diff_expr, task.eval_expr, task.diff_by,
+			task.complex_variables, out, cache
+		);
+		return;
+	}
+
+	Precision precision = options.precision;
+	if (options.automatic)
+		precision = choose_task_precision(task, options.tolerance).precision;
+	switch (precision) {
+	case Precision::Float:
+		run_as<float>(task, out, cache);
+		break;
+	case Precision::Double:
+		run_as<double>(task, out, cache);
+		break;
+	default:
+		run_as<long double>(task, out, cache);
+	}
+}
+
+// A batch job is one line holding the same arguments as a single run, separated by tabs:
+//   --diff<TAB>x^2 * y<TAB>--by<TAB>x
+//   --eval<TAB>x^2 * y<TAB>x=2<TAB>y=3
+std::vector<std::string> split_job(const std::string &line) {
+	std::vector<std::string> fields;
+	std::stringstream stream(line);
+	std::string field;
+	while (std::getline(stream, field, '\t')) {
+		if (!field.empty()) fields.push_back(field);
+	}
+	return fields;
+}
+
+// Jobs run on `jobs` worker threads; results are written in input order.
+// At most `window` jobs are held in memory, whether queued, running or waiting to be printed.
+void run_batch(
+	std::istream &input, std::ostream &output, unsigned jobs, DiskCache *cache,
+	const PrecisionOptions &precision
+) {
+	const std::size_t window = std::size_t(jobs) * 16;
+	std::mutex mutex;
+	std::condition_variable queue_changed, window_changed;
+	std::deque<std::pair<std::size_t, std::string>> queue;
+	std::map<std::size_t, std::string> finished;
+	std::size_t next_to_print = 0;
+	bool input_done = false;
+
+	auto worker = [&] {
+		for (;;) {
+			std::pair<std::size_t, std::string> job;
+			{
+				std::unique_lock lock(mutex);
+				queue_changed.wait(lock, [&] { return !queue.empty() || input_done; });
+				if (queue.empty()) return;
+				job = std::move(queue.front());
+				queue.pop_front();
+			}
+
+			std::string result;
+			try {
+				Task task = parse_task(split_job(job.second));
+				std::ostringstream stream;
+				run(task, stream, cache, precision);
+				result = std::move(stream).str();
+			} catch (const std::exception &e) {
+				result = std::string("Error: ") + e.what();
+			}
+
+			std::lock_guard lock(mutex);
+			finished.emplace(job.first, std::move(result));
+			auto it = finished.begin();
+			for (; it != finished.end() && it->first == next_to_print; ++it, ++next_to_print) {
+				output << it->second << "\n";
+			}
+			finished.erase(finished.begin(), it);
+			window_changed.notify_one();
+		}
+	};
+
+	std::vector<std::jthread> workers;
+	for (unsigned i = 0; i < jobs; i++) workers.emplace_back(worker);
+
+	std::string line;
+	std::size_t next_job = 0;
+	while (std::getline(input, line)) {
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (line.empty()) continue;
+
+		std::unique_lock lock(mutex);
+		window_changed.wait(lock, [&] { return next_job - next_to_print < window; });
+		queue.emplace_back(next_job++, std::move(line));
+		queue_changed.notify_one();
+	}
+	{
+		std::lock_guard lock(mutex);
+		input_done = true;
+	}
+	queue_changed.notify_all();
+	workers.clear();
+	output.flush();
+}
+
+// Options of the derivative cache, valid in single and batch runs:
+//   --cache-dir DIR      reuse derivatives stored in DIR by earlier runs
+//   --cache-size BYTES   evict the least recently used entries beyond this size
+//   --cache-stats        print the cache's hit and miss counters to stderr
+struct CacheOptions {
+	std::string directory;
+	std::uint64_t max_bytes = 256ull << 20;
+	bool print_stats = false;
+};
+
+CacheOptions take_cache_options(std::vector<std::string> &args) {
+	CacheOptions options;
+	std::vector<std::string> rest;
+	for (std::size_t i = 0; i < args.size(); i++) {
+		if (args[i] == "--cache-dir" || args[i] == "--cache-size") {
+			if (i + 1 >= args.size())
+				throw std::invalid_argument("No value specified for " + args[i]);
+			if (args[i] == "--cache-dir") options.directory = args[i + 1];
+			else options.max_bytes = std::stoull(args[i + 1]);
+			i++;
+		} else if (args[i] == "--cache-stats") {
+			options.print_stats = true;
+		} else {
+			rest.push_back(args[i]);
+		}
+	}
+	args = std::move(rest);
+	return options;
+}
+
+int main(int argc, char* argv[]) {
+	std::vector<std::string> args(argv + 1, argv + argc);
+
+	const CacheOptions cache_options = take_cache_options(args);
+	PrecisionOptions precision = take_precision_options(args);
+	std::optional<DiskCache> cache;
+	if (!cache_options.directory.empty())
+		cache.emplace(cache_options.directory, cache_options.max_bytes);
+	DiskCache *cache_ptr = cache ? &*cache : nullptr;
+	auto print_cache_stats = [&] {
+		if (!cache || !cache_options.print_stats) return;
+		const DiskCacheStats stats = cache->stats();
+		std::cerr << "Cache: " << stats.hits << " hits, " << stats.misses
+				  << " misses, " << stats.bytes << " bytes\n";
+	};
+
+	if (!args.empty() && args[0] == "--batch") {
+		std::string batch_path = "-";
+		unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+		for (std::size_t i = 1; i < args.size(); i++) {
+			if (args[i] == "--jobs") {
+				if (++i >= args.size())
+					throw std::invalid_argument("No value specified for --jobs");
+				jobs = std::max(1, std::stoi(args[i]));
+			} else {
+				batch_path = args[i];
+			}
+		}
+
+		if (batch_path == "-") {
+			run_batch(std::cin, std::cout, jobs, cache_ptr, precision);
+		} else {
+			std::ifstream input(batch_path);
+			if (!input)
+				throw std::invalid_argument("Can not open batch file: " + batch_path);
+			run_batch(input, std::cout, jobs, cache_ptr, precision);
+		}
+		print_cache_stats();
+		return 0;
+	}
+
+	Task task = parse_task(args);
+	if (precision.automatic) {
+		const PrecisionChoice choice = choose_task_precision(task, precision.tolerance);
+		std::cerr << "Precision: " << precision_name(choice.precision)
+				  << " (float error " << choice.float_error << ", double error "
+				  << choice.double_error << ")\n";
+		precision.precision = choice.precision;
+		precision.automatic = false;
+	}
+	run(task, std::cout, cache_ptr, precision);
+	std::cout << "\n";
+	print_cache_stats();
 	return 0;
 }
@@ -1,10 +1,34 @@
 #include "expressions.hpp"
+#include "../tape/Tape.hpp"
 
-#include <format>
+#include <cmath>
+#include <functional>
 #include <stdexcept>
 
-template<>
-Constant<RealNumber>::Constant(const RealNumber _value) : value(_value) {}
+namespace {
+
+// Constants are interned by value and sign, so that 0 and -0 stay different nodes: they give
+// different results, e.g. as divisors
+std::size_t hash_value(const RealNumber value) {
+    return hash_combine(std::hash<RealNumber>{}(value), std::signbit(value));
+}
+
+std::size_t hash_value(const ComplexNumber value) {
+    return hash_combine(hash_value(value.real()), hash_value(value.imag()));
+}
+
+bool same_value(const RealNumber lhs, const RealNumber rhs) {
+    return lhs == rhs && std::signbit(lhs) == std::signbit(rhs);
+}
+
+bool same_value(const ComplexNumber lhs, const ComplexNumber rhs) {
+    return same_value(lhs.real(), rhs.real()) && same_value(lhs.imag(), rhs.imag());
+}
+
+}  // namespace
+
+template<typename T>
+Constant<T>::Constant(const T _value) : value(_value) {}
 
 template<>
 Constant<ComplexNumber>::Constant(const ComplexNumber _value) : value(_value) {
@@ -17,31 +41,34 @@ Constant<ComplexNumber>::Constant(const ComplexNumber _value) : value(_value) {
 
 template<typename T>
 std::shared_ptr<BaseExpr<T>> Constant<T>::with_values(
-    const std::unordered_map<std::string, T>& values
+    const std::unordered_map<std::string, T>&
 ) const {
-    return std::make_shared<Constant>(Constant(value));
+    return std::const_pointer_cast<BaseExpr<T>>(this->shared_from_this());
 }
 
-template<>
-std::string Constant<RealNumber>::to_string() const {
-    return std::to_string(value);
+template<typename T>
+void Constant<T>::print(std::ostream& out) const {
+    out << std::to_string(value);
 }
 
 template<>
-std::string Constant<ComplexNumber>::to_string() const {
+void Constant<ComplexNumber>::print(std::ostream& out) const {
     if (value.real() != 0) {
-        return std::to_string(value.real());
-    }
-    if (value.imag() != 0) {
-        if (value.imag() == -1) {
-            return "-i";
-        }
-        if (value.imag() == 1) {
-            return "i";
-        }
-        return std::format("{}i", std::to_string(value.imag()));
+        out << std::to_string(value.real());
+    } else if (value.imag() == -1) {
+        out << "-i";
+    } else if (value.imag() == 1) {
+        out << "i";
+    } else if (value.imag() != 0) {
+        out << std::to_string(value.imag()) << 'i';
+    } else {
+        out << '0';  // we have an invariant that at least one of the parts is 0
     }
-    return "0";  // we have an invariant that at least one of the parts is 0
+}
+
+template<typename T>
+OpPrecedence Constant<T>::precedence() const {
+    return OpPrecedence::Atom;
 }
 
 template<typename T>
@@ -50,9 +77,37 @@ T Constant<T>::resolve() const {
 }
 
 template<typename T>
-std::shared_ptr<BaseExpr<T>> Constant<T>::diff(const std::string& by) const {
-    return std::make_shared<Constant>(0);
+std::shared_ptr<BaseExpr<T>> Constant<T>::diff(const std::string&, DiffCache<T>&) const {
+    return make_node<Constant>(0);
+}
+
+template<typename T>
+std::size_t Constant<T>::hash() const {
+    return hash_combine(static_cast<std::size_t>(OpCode::Const), hash_value(value));
+}
+
+template<typename T>
+bool Constant<T>::equals(const BaseExpr<T>& other) const {
+    const auto* expr = dynamic_cast<const Constant*>(&other);
+    return expr != nullptr && same_value(expr->value, value);
+}
+
+template<typename T>
+std::uint32_t Constant<T>::compile(TapeBuilder<T>& builder) const {
+    return builder.emit_constant(value);
+}
+
+template<typename T>
+std::shared_ptr<BaseExpr<T>> Constant<T>::simplify(Simplifier<T>&) const {
+    return std::const_pointer_cast<BaseExpr<T>>(this->shared_from_this());
+}
+
+template<typename T>
+T Constant<T>::get_value() const {
+    return value;
 }
 
 template class Constant<RealNumber>;
+template class Constant<double>;
+template class Constant<float>;
 template class Constant<ComplexNumber>;
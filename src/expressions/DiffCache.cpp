@@ -0,0 +1,76 @@
+#include "expressions.hpp"
+
+template<typename T>
+DiffCache<T>::DiffCache(const std::size_t _max_entries)
+    : zero_node(make_node<Constant<T>>(0)), max_entries(_max_entries) {}
+
+template<typename T>
+std::shared_ptr<BaseExpr<T>> DiffCache<T>::diff(const std::shared_ptr<BaseExpr<T>>& node, const std::string& by) {
+    auto by_it = derivatives.find(by);
+    if (by_it == derivatives.end()) {
+        by_it = derivatives.emplace(by, ByVariable{VariableSet::id(by), {}}).first;
+    }
+    const std::uint32_t by_id = by_it->second.id;
+    if (!node->dependencies().contains(by_id)) {
+        return zero_node;
+    }
+    if (const auto it = by_it->second.nodes.find(node.get()); it != by_it->second.nodes.end()) {
+        ++hit_count;
+        return it->second.derivative;
+    }
+    ++miss_count;
+
+    // Differentiating the children may clear the cache, so the variable is looked up again
+    auto derivative = node->diff(by, *this);
+    if (max_entries != 0 && entries >= max_entries) {
+        clear();
+    }
+    auto& nodes = derivatives.try_emplace(by, ByVariable{by_id, {}}).first->second.nodes;
+    nodes.emplace(node.get(), Entry{node, derivative});
+    ++entries;
+    return derivative;
+}
+
+template<typename T>
+const std::shared_ptr<BaseExpr<T>>& DiffCache<T>::zero() const {
+    return zero_node;
+}
+
+template<typename T>
+void DiffCache<T>::clear() {
+    derivatives.clear();
+    entries = 0;
+}
+
+template<typename T>
+std::size_t DiffCache<T>::size() const {
+    return entries;
+}
+
+template<typename T>
+std::size_t DiffCache<T>::max_size() const {
+    return max_entries;
+}
+
+template<typename T>
+void DiffCache<T>::set_max_size(const std::size_t _max_entries) {
+    max_entries = _max_entries;
+    if (max_entries != 0 && entries > max_entries) {
+        clear();
+    }
+}
+
+template<typename T>
+std::size_t DiffCache<T>::hits() const {
+    return hit_count;
+}
+
+template<typename T>
+std::size_t DiffCache<T>::misses() const {
+    return miss_count;
+}
+
+template class DiffCache<RealNumber>;
+template class DiffCache<double>;
+template class DiffCache<float>;
+template class DiffCache<ComplexNumber>;
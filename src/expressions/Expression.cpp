@@ -1,36 +1,71 @@
 #include "expressions.hpp"
+#include "../io/MappedFile.hpp"
 #include "../parser/Parser.hpp"
+#include "../tape/Tape.hpp"
 
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
 #include <utility>
+#include <vector>
+
+namespace {
+
+// Values of `names`, in order
+template<typename T>
+std::vector<T> ordered_values(
+    const std::vector<std::string>& names,
+    const std::unordered_map<std::string, T>& values
+) {
+    std::vector<T> ordered(names.size());
+    for (std::size_t slot = 0; slot < names.size(); ++slot) {
+        const auto it = values.find(names[slot]);
+        if (it == values.end()) {
+            throw std::runtime_error(std::format("Can not resolve variable \"{}\"", names[slot]));
+        }
+        ordered[slot] = it->second;
+    }
+    return ordered;
+}
+
+}  // namespace
 
 template<typename T>
 Expression<T>::Expression(std::shared_ptr<BaseExpr<T>> expression_impl)
     : inner(std::move(expression_impl)) {}
 
-template<>
-Expression<RealNumber>::Expression(RealNumber number)
-    : inner(std::make_shared<Constant<RealNumber>>(number)) {}
+template<typename T>
+Expression<T>::Expression(T number)
+    : inner(make_node<Constant<T>>(number)) {}
 
 template<>
 Expression<ComplexNumber>::Expression(ComplexNumber number) {
     if (number.real() == 0 || number.imag() == 0) {
-        inner = std::make_shared<Constant<ComplexNumber>>(number);
+        inner = make_node<Constant<ComplexNumber>>(number);
     } else {
-        inner = std::make_shared<AddOp<ComplexNumber>>(
-            std::make_shared<Constant<ComplexNumber>>(ComplexNumber(number.real(), 0)),
-            std::make_shared<Constant<ComplexNumber>>(ComplexNumber(0, number.imag()))
+        inner = make_node<AddOp<ComplexNumber>>(
+            make_node<Constant<ComplexNumber>>(ComplexNumber(number.real(), 0)),
+            make_node<Constant<ComplexNumber>>(ComplexNumber(0, number.imag()))
         );
     }
 }
 
 template<typename T>
-Expression<T> Expression<T>::from_string(const std::string& expression_str, bool case_sensitive) {
+Expression<T> Expression<T>::from_string(const std::string_view expression_str, bool case_sensitive) {
     return Parser<T>(expression_str, case_sensitive).parse();
 }
 
+template<typename T>
+Expression<T> Expression<T>::from_file(const std::filesystem::path& path, bool case_sensitive) {
+    const MappedFile file(path);
+    return from_string(file.text(), case_sensitive);
+}
+
 template<typename T>
 Expression<T>::Expression(const std::string& var_name)
-    : inner(std::make_shared<Variable<T>>(var_name)) {}
+    : inner(make_node<Variable<T>>(var_name)) {}
 
 template<typename T>
 Expression<T>& Expression<T>::operator=(const Expression& rhs) {
@@ -40,29 +75,88 @@ Expression<T>& Expression<T>::operator=(const Expression& rhs) {
     return *this;
 }
 
+template<typename T>
+Expression<T> Expression<T>::from_compiled(const CompiledExpression<T>& compiled) {
+    const std::vector<Instruction>& code = compiled.instructions();
+    std::vector<std::shared_ptr<BaseExpr<T>>> nodes;
+    nodes.reserve(code.size());
+    for (const Instruction& instr : code) {
+        switch (instr.op) {
+        case OpCode::Const:
+            nodes.push_back(make_node<Constant<T>>(compiled.constants()[instr.lhs]));
+            break;
+        case OpCode::Var:
+            nodes.push_back(make_node<Variable<T>>(compiled.variables()[instr.lhs]));
+            break;
+        case OpCode::Add:
+            nodes.push_back(make_node<AddOp<T>>(nodes[instr.lhs], nodes[instr.rhs]));
+            break;
+        case OpCode::Sub:
+            nodes.push_back(make_node<SubOp<T>>(nodes[instr.lhs], nodes[instr.rhs]));
+            break;
+        case OpCode::Mul:
+            nodes.push_back(make_node<MulOp<T>>(nodes[instr.lhs], nodes[instr.rhs]));
+            break;
+        case OpCode::Div:
+            nodes.push_back(make_node<DivOp<T>>(nodes[instr.lhs], nodes[instr.rhs]));
+            break;
+        case OpCode::Pow:
+            nodes.push_back(make_node<PowOp<T>>(nodes[instr.lhs], nodes[instr.rhs]));
+            break;
+        case OpCode::Sin:
+            nodes.push_back(make_node<SinFunc<T>>(nodes[instr.lhs]));
+            break;
+        case OpCode::Cos:
+            nodes.push_back(make_node<CosFunc<T>>(nodes[instr.lhs]));
+            break;
+        case OpCode::Ln:
+            nodes.push_back(make_node<LnFunc<T>>(nodes[instr.lhs]));
+            break;
+        case OpCode::Exp:
+            nodes.push_back(make_node<ExpFunc<T>>(nodes[instr.lhs]));
+            break;
+        }
+    }
+    return Expression(nodes.back());
+}
+
+template<typename T>
+void Expression<T>::save(const std::filesystem::path& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error(std::format("Can not open \"{}\" for writing", path.string()));
+    }
+    compile().serialize(out);
+}
+
+template<typename T>
+Expression<T> Expression<T>::load(const std::filesystem::path& path) {
+    return from_compiled(CompiledExpression<T>::load(path));
+}
+
 template<typename T>
 Expression<T> Expression<T>::sin() const {
-    return Expression(std::make_shared<SinFunc<T>>(inner));
+    return Expression(make_node<SinFunc<T>>(inner));
 }
 
 template<typename T>
 Expression<T> Expression<T>::cos() const {
-    return Expression(std::make_shared<CosFunc<T>>(inner));
+    return Expression(make_node<CosFunc<T>>(inner));
 }
 
 template<typename T>
 Expression<T> Expression<T>::ln() const {
-    return Expression(std::make_shared<LnFunc<T>>(inner));
+    return Expression(make_node<LnFunc<T>>(inner));
 }
 
 template<typename T>
 Expression<T> Expression<T>::exp() const {
-    return Expression(std::make_shared<ExpFunc<T>>(inner));
+    return Expression(make_node<ExpFunc<T>>(inner));
 }
 
 template<typename T>
 Expression<T> Expression<T>::operator+(const Expression& rhs) const {
-    return Expression(std::make_shared<AddOp<T>>(inner, rhs.inner));
+    return Expression(make_node<AddOp<T>>(inner, rhs.inner));
 }
 
 template<typename T>
@@ -73,7 +167,7 @@ Expression<T>& Expression<T>::operator+=(const Expression& rhs) {
 
 template<typename T>
 Expression<T> Expression<T>::operator-(const Expression& rhs) const {
-    return Expression(std::make_shared<SubOp<T>>(inner, rhs.inner));
+    return Expression(make_node<SubOp<T>>(inner, rhs.inner));
 }
 
 template<typename T>
@@ -84,7 +178,7 @@ Expression<T>& Expression<T>::operator-=(const Expression& rhs) {
 
 template<typename T>
 Expression<T> Expression<T>::operator*(const Expression& rhs) const {
-    return Expression(std::make_shared<MulOp<T>>(inner, rhs.inner));
+    return Expression(make_node<MulOp<T>>(inner, rhs.inner));
 }
 
 template<typename T>
@@ -95,7 +189,7 @@ Expression<T>& Expression<T>::operator*=(const Expression& rhs) {
 
 template<typename T>
 Expression<T> Expression<T>::operator/(const Expression& rhs) const {
-    return Expression(std::make_shared<DivOp<T>>(inner, rhs.inner));
+    return Expression(make_node<DivOp<T>>(inner, rhs.inner));
 }
 
 template<typename T>
@@ -106,7 +200,7 @@ Expression<T>& Expression<T>::operator/=(const Expression& rhs) {
 
 template<typename T>
 Expression<T> Expression<T>::operator^(const Expression& rhs) const {
-    return Expression(std::make_shared<PowOp<T>>(inner, rhs.inner));
+    return Expression(make_node<PowOp<T>>(inner, rhs.inner));
 }
 
 template<typename T>
@@ -120,19 +214,127 @@ Expression<T> Expression<T>::with_values(std::unordered_map<std::string, T> &val
     return Expression(inner->with_values(values));
 }
 
+// Both go through the tape so that subexpressions shared in the graph are computed once
+
 template<typename T>
 T Expression<T>::resolve() const {
-    return inner->resolve();
+    return compile().evaluate(std::unordered_map<std::string, T>{});
 }
 
 template<typename T>
 T Expression<T>::resolve_with(std::unordered_map<std::string, T> &values) const {
-    return this->with_values(values).resolve();
+    return compile().evaluate(values);
+}
+
+template<typename T>
+void Expression<T>::resolve_batch(
+    const std::unordered_map<std::string, std::span<const T>>& columns,
+    std::span<T> out
+) const {
+    CompiledExpression<T> compiled = compile();
+    std::vector<std::span<const T>> ordered;
+    ordered.reserve(compiled.variables().size());
+    for (const std::string& name : compiled.variables()) {
+        const auto it = columns.find(name);
+        if (it == columns.end()) {
+            throw std::runtime_error(std::format("Can not resolve variable \"{}\"", name));
+        }
+        ordered.push_back(it->second);
+    }
+    compiled.evaluate_batch(ordered, out);
+}
+
+template<typename T>
+T Expression<T>::gradient(
+    const std::unordered_map<std::string, T>& values,
+    std::unordered_map<std::string, T>& partials
+) const {
+    CompiledExpression<T> compiled = compile();
+    const std::vector<std::string>& names = compiled.variables();
+
+    const std::vector<T> ordered = ordered_values(names, values);
+
+    std::vector<T> ordered_partials(names.size());
+    const T value = compiled.gradient(ordered, ordered_partials);
+    for (std::size_t slot = 0; slot < names.size(); ++slot) {
+        partials[names[slot]] = ordered_partials[slot];
+    }
+    return value;
 }
 
 template<typename T>
-Expression<T> Expression<T>::diff(const std::string& by) const {
-    return Expression(inner->diff(by));
+Dual<T> Expression<T>::resolve_dual(const std::unordered_map<std::string, T>& values, const std::string& by) const {
+    return resolve_dual(values, std::unordered_map<std::string, T>{{by, T(1)}});
+}
+
+template<typename T>
+Dual<T> Expression<T>::resolve_dual(
+    const std::unordered_map<std::string, T>& values,
+    const std::unordered_map<std::string, T>& direction
+) const {
+    CompiledExpression<T> compiled = compile();
+    const std::vector<std::string>& names = compiled.variables();
+
+    std::vector<T> components(names.size(), T(0));
+    for (std::size_t slot = 0; slot < names.size(); ++slot) {
+        if (const auto it = direction.find(names[slot]); it != direction.end()) {
+            components[slot] = it->second;
+        }
+    }
+    return compiled.directional(ordered_values(names, values), components);
+}
+
+template<typename T>
+std::vector<T> Expression<T>::derivatives(
+    const std::unordered_map<std::string, T>& values,
+    const std::string& by,
+    const std::size_t order
+) const {
+    CompiledExpression<T> compiled = compile();
+    const std::vector<std::string>& names = compiled.variables();
+
+    const std::vector<T> ordered = ordered_values(names, values);
+
+    std::vector<T> result(order + 1, T(0));
+    const auto by_slot = std::find(names.begin(), names.end(), by);
+    if (by_slot == names.end()) {
+        // The expression does not depend on `by`
+        result[0] = compiled.evaluate(ordered);
+        return result;
+    }
+    compiled.taylor(ordered, static_cast<std::uint32_t>(by_slot - names.begin()), result);
+    return result;
+}
+
+template<typename T>
+Expression<T> Expression<T>::diff(const std::string& by, const bool simplified) const {
+    DiffCache<T> cache;
+    return diff(by, cache, simplified);
+}
+
+template<typename T>
+Expression<T> Expression<T>::diff(const std::string& by, DiffCache<T>& cache, const bool simplified) const {
+    Expression derivative(cache.diff(inner, by));
+    return simplified ? derivative.simplify() : derivative;
+}
+
+template<typename T>
+Expression<T> Expression<T>::simplify() const {
+    return Expression(Simplifier<T>().simplify(inner));
+}
+
+template<typename T>
+CompiledExpression<T> Expression<T>::compile() const {
+    TapeBuilder<T> builder;
+    builder.lower(inner);
+    return builder.finish();
+}
+
+template<typename T>
+CompiledExpression<T> Expression<T>::bind(const std::vector<std::string>& variables) const {
+    TapeBuilder<T> builder(variables);
+    builder.lower(inner);
+    return builder.finish();
 }
 
 template<typename T>
@@ -140,5 +342,24 @@ std::string Expression<T>::to_string() const {
     return inner->to_string();
 }
 
+template<typename T>
+void Expression<T>::print(std::ostream& out) const {
+    inner->print(out);
+}
+
+template<typename T>
+std::string BaseExpr<T>::to_string() const {
+    std::ostringstream out;
+    print(out);
+    return out.str();
+}
+
 template class Expression<RealNumber>;
+template class Expression<double>;
+template class Expression<float>;
 template class Expression<ComplexNumber>;
+
+template std::string BaseExpr<RealNumber>::to_string() const;
+template std::string BaseExpr<double>::to_string() const;
+template std::string BaseExpr<float>::to_string() const;
+template std::string BaseExpr<ComplexNumber>::to_string() const;
@@ -0,0 +1,122 @@
+#include "expressions.hpp"
+
+#include <vector>
+
+template<typename T>
+BaseExpr<T>::~BaseExpr() {
+    if (interned) {
+        InternTable<T>::instance().erase(this);
+    }
+}
+
+template<typename T>
+void BaseExpr<T>::release(std::shared_ptr<BaseExpr>& child) {
+    thread_local std::vector<std::shared_ptr<BaseExpr>>* deferred = nullptr;
+
+    // Not the last reference: nothing is destroyed here
+    if (child.use_count() > 1) {
+        child.reset();
+        return;
+    }
+    if (deferred) {
+        deferred->push_back(std::move(child));
+        return;
+    }
+    std::vector<std::shared_ptr<BaseExpr>> queue;
+    deferred = &queue;
+    queue.push_back(std::move(child));
+    while (!queue.empty()) {
+        // Destroying the node may append its own children
+        std::shared_ptr<BaseExpr> node = std::move(queue.back());
+        queue.pop_back();
+        node.reset();
+    }
+    deferred = nullptr;
+}
+
+template<typename T>
+const VariableSet& BaseExpr<T>::dependencies() const {
+    return variable_dependencies;
+}
+
+template<typename T>
+InternTable<T>& InternTable<T>::instance() {
+    // Never destroyed: nodes held by other static objects may still unregister during exit
+    static InternTable* table = new InternTable;
+    return *table;
+}
+
+template<typename T>
+typename InternTable<T>::Shard& InternTable<T>::shard_for(const std::size_t hash) {
+    return shards[hash % SHARD_COUNT];
+}
+
+template<typename T>
+std::shared_ptr<BaseExpr<T>> InternTable<T>::find(const BaseExpr<T>& probe, const NodeArena* const arena) {
+    const std::size_t hash = probe.hash();
+    Shard& shard = shard_for(hash);
+
+    // Candidates that turn out to be different are released only after unlocking:
+    // dropping the last reference would otherwise re-enter `erase` on the same shard
+    std::vector<std::shared_ptr<BaseExpr<T>>> rejected;
+    std::lock_guard lock(shard.mutex);
+    const auto [begin, end] = shard.nodes.equal_range(hash);
+    for (auto it = begin; it != end; ++it) {
+        if (it->second->arena != arena) {
+            continue;
+        }
+        // A node whose destructor is already running can not be locked any more
+        auto node = it->second->weak_from_this().lock();
+        if (!node) {
+            continue;
+        }
+        if (node->equals(probe)) {
+            return node;
+        }
+        rejected.push_back(std::move(node));
+    }
+    return nullptr;
+}
+
+template<typename T>
+void InternTable<T>::insert(const std::shared_ptr<BaseExpr<T>>& node, const NodeArena* const arena) {
+    node->intern_hash = node->hash();
+    node->interned = true;
+    node->arena = arena;
+    Shard& shard = shard_for(node->intern_hash);
+    std::lock_guard lock(shard.mutex);
+    shard.nodes.emplace(node->intern_hash, node.get());
+}
+
+template<typename T>
+void InternTable<T>::erase(const BaseExpr<T>* node) {
+    Shard& shard = shard_for(node->intern_hash);
+    std::lock_guard lock(shard.mutex);
+    const auto [begin, end] = shard.nodes.equal_range(node->intern_hash);
+    for (auto it = begin; it != end; ++it) {
+        if (it->second == node) {
+            shard.nodes.erase(it);
+            return;
+        }
+    }
+}
+
+template<typename T>
+std::size_t InternTable<T>::size() const {
+    std::size_t total = 0;
+    for (const Shard& shard : shards) {
+        std::lock_guard lock(shard.mutex);
+        total += shard.nodes.size();
+    }
+    return total;
+}
+
+template class BaseExpr<RealNumber>;
+template class BaseExpr<double>;
+template class BaseExpr<float>;
+template class BaseExpr<ComplexNumber>;
+
+template class InternTable<RealNumber>;
+template class InternTable<double>;
+template class InternTable<float>;
+template class InternTable<ComplexNumber>;
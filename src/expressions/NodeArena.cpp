@@ -0,0 +1,56 @@
+#include "expressions.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+namespace {
+
+std::size_t aligned_offset(const std::byte* base, const std::size_t offset, const std::size_t alignment) {
+    const auto address = reinterpret_cast<std::uintptr_t>(base) + offset;
+    return offset + (alignment - address % alignment) % alignment;
+}
+
+}  // namespace
+
+double ArenaStats::bytes_per_node() const {
+    return nodes == 0 ? 0.0 : static_cast<double>(bytes_used) / static_cast<double>(nodes);
+}
+
+NodeArena::NodeArena(const std::size_t block_size) : block_size(block_size) {}
+
+void* NodeArena::allocate(const std::size_t bytes, const std::size_t alignment) {
+    std::size_t start = blocks.empty() ? 0 : aligned_offset(blocks.back().data.get(), offset, alignment);
+    if (blocks.empty() || start + bytes > blocks.back().size) {
+        // Oversized requests get a block of their own
+        const std::size_t size = std::max(block_size, bytes + alignment);
+        blocks.push_back(Block{std::make_unique<std::byte[]>(size), size});
+        bytes_reserved += size;
+        offset = 0;
+        start = aligned_offset(blocks.back().data.get(), offset, alignment);
+    }
+    bytes_used += start + bytes - offset;
+    offset = start + bytes;
+    ++nodes;
+    return blocks.back().data.get() + start;
+}
+
+ArenaStats NodeArena::stats() const {
+    return ArenaStats{nodes, bytes_used, bytes_reserved, blocks.size()};
+}
+
+std::shared_ptr<NodeArena>& NodeArena::current_slot() {
+    static thread_local std::shared_ptr<NodeArena> arena;
+    return arena;
+}
+
+const std::shared_ptr<NodeArena>& NodeArena::current() {
+    return current_slot();
+}
+
+ArenaScope::ArenaScope(std::shared_ptr<NodeArena> arena)
+    : previous(std::exchange(NodeArena::current_slot(), std::move(arena))) {}
+
+ArenaScope::~ArenaScope() {
+    NodeArena::current_slot() = std::move(previous);
+}
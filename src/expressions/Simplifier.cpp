@@ -0,0 +1,122 @@
+#include "expressions.hpp"
+
+#include <cmath>
+
+namespace {
+
+bool is_representable(const RealNumber value) {
+    return std::isfinite(value);
+}
+
+bool is_representable(const ComplexNumber value) {
+    return std::isfinite(value.real()) && std::isfinite(value.imag()) &&
+        (value.real() == 0 || value.imag() == 0);
+}
+
+}  // namespace
+
+template<typename T>
+std::shared_ptr<BaseExpr<T>> Simplifier<T>::simplify(const std::shared_ptr<BaseExpr<T>>& node) {
+    if (const auto it = simplified.find(node.get()); it != simplified.end()) {
+        return it->second;
+    }
+    // A subtree without variables folds to its value in one evaluation, unless that value can not be
+    // held by a constant; then it is simplified like any other
+    std::shared_ptr<BaseExpr<T>> result;
+    if (node->dependencies().empty()) {
+        result = make_constant(node->resolve());
+    }
+    if (!result) {
+        result = node->simplify(*this);
+    }
+    simplified.emplace(node.get(), result);
+    return result;
+}
+
+template<typename T>
+std::optional<T> Simplifier<T>::constant_value(const std::shared_ptr<BaseExpr<T>>& node) {
+    if (const auto* constant = dynamic_cast<const Constant<T>*>(node.get())) {
+        return constant->get_value();
+    }
+    return std::nullopt;
+}
+
+template<typename T>
+bool Simplifier<T>::is_constant(const std::shared_ptr<BaseExpr<T>>& node, const T value) {
+    const auto node_value = constant_value(node);
+    return node_value.has_value() && node_value.value() == value;
+}
+
+template<typename T>
+std::shared_ptr<BaseExpr<T>> Simplifier<T>::make_constant(const T value) {
+    if (!is_representable(value)) {
+        return nullptr;
+    }
+    return make_node<Constant<T>>(value);
+}
+
+template<typename T>
+std::pair<T, std::shared_ptr<BaseExpr<T>>> Simplifier<T>::split_coefficient(
+    const std::shared_ptr<BaseExpr<T>>& node
+) {
+    if (const auto value = constant_value(node)) {
+        return {value.value(), nullptr};
+    }
+    if (const auto* mul = dynamic_cast<const MulOp<T>*>(node.get())) {
+        if (const auto value = constant_value(mul->get_lhs())) {
+            return {value.value(), mul->get_rhs()};
+        }
+        if (const auto value = constant_value(mul->get_rhs())) {
+            return {value.value(), mul->get_lhs()};
+        }
+    }
+    if (const auto* div = dynamic_cast<const DivOp<T>*>(node.get())) {
+        const auto value = constant_value(div->get_lhs());
+        if (value.has_value() && value.value() != T(1)) {
+            return {value.value(), make_node<DivOp<T>>(make_node<Constant<T>>(1), div->get_rhs())};
+        }
+    }
+    return {T(1), node};
+}
+
+template<typename T>
+std::pair<std::shared_ptr<BaseExpr<T>>, std::shared_ptr<BaseExpr<T>>> Simplifier<T>::split_power(
+    const std::shared_ptr<BaseExpr<T>>& node
+) {
+    if (const auto* pow = dynamic_cast<const PowOp<T>*>(node.get())) {
+        return {pow->get_lhs(), pow->get_rhs()};
+    }
+    if (const auto* div = dynamic_cast<const DivOp<T>*>(node.get()); div && is_constant(div->get_lhs(), T(1))) {
+        auto [base, exponent] = split_power(div->get_rhs());
+        return {base, MulOp<T>::simplified(make_node<Constant<T>>(-1), exponent)};
+    }
+    return {node, make_node<Constant<T>>(1)};
+}
+
+template<typename T>
+std::shared_ptr<BaseExpr<T>> Simplifier<T>::scale(const T coefficient, const std::shared_ptr<BaseExpr<T>>& term) {
+    if (const auto value = constant_value(term)) {
+        if (auto folded = make_constant(coefficient * value.value())) {
+            return folded;
+        }
+    }
+    if (coefficient == T(0)) {
+        return make_node<Constant<T>>(0);
+    }
+    if (coefficient == T(1)) {
+        return term;
+    }
+    auto constant = make_constant(coefficient);
+    if (!constant) {
+        return nullptr;
+    }
+    if (const auto* div = dynamic_cast<const DivOp<T>*>(term.get()); div && is_constant(div->get_lhs(), T(1))) {
+        return make_node<DivOp<T>>(constant, div->get_rhs());
+    }
+    return make_node<MulOp<T>>(constant, term);
+}
+
+template class Simplifier<RealNumber>;
+template class Simplifier<double>;
+template class Simplifier<float>;
+template class Simplifier<ComplexNumber>;
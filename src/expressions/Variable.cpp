@@ -1,24 +1,33 @@
 #include "expressions.hpp"
+#include "../tape/Tape.hpp"
 
 #include <utility>
 #include <format>
+#include <functional>
 
 template<typename T>
-Variable<T>::Variable(std::string _name) : name(std::move(_name)) {}
+Variable<T>::Variable(std::string _name) : name(std::move(_name)) {
+    this->variable_dependencies = VariableSet::of(VariableSet::id(name));
+}
 
 template<typename T>
 std::shared_ptr<BaseExpr<T>> Variable<T>::with_values(
     const std::unordered_map<std::string, T>& values
 ) const {
     if (values.contains(name)) {
-        return std::make_shared<Constant<T>>(values.at(name));
+        return make_node<Constant<T>>(values.at(name));
     }
-    return std::make_shared<Variable>(*this);
+    return std::const_pointer_cast<BaseExpr<T>>(this->shared_from_this());
+}
+
+template<typename T>
+void Variable<T>::print(std::ostream& out) const {
+    out << name;
 }
 
 template<typename T>
-std::string Variable<T>::to_string() const {
-    return name;
+OpPrecedence Variable<T>::precedence() const {
+    return OpPrecedence::Atom;
 }
 
 template<typename T>
@@ -27,9 +36,32 @@ T Variable<T>::resolve() const {
 }
 
 template<typename T>
-std::shared_ptr<BaseExpr<T>> Variable<T>::diff(const std::string& by) const {
-    return std::make_shared<Constant<T>>(by == name ? 1 : 0);
+std::shared_ptr<BaseExpr<T>> Variable<T>::diff(const std::string& by, DiffCache<T>&) const {
+    return make_node<Constant<T>>(by == name ? 1 : 0);
+}
+
+template<typename T>
+std::size_t Variable<T>::hash() const {
+    return hash_combine(static_cast<std::size_t>(OpCode::Var), std::hash<std::string>{}(name));
+}
+
+template<typename T>
+bool Variable<T>::equals(const BaseExpr<T>& other) const {
+    const auto* expr = dynamic_cast<const Variable*>(&other);
+    return expr != nullptr && expr->name == name;
+}
+
+template<typename T>
+std::uint32_t Variable<T>::compile(TapeBuilder<T>& builder) const {
+    return builder.emit_variable(name);
+}
+
+template<typename T>
+std::shared_ptr<BaseExpr<T>> Variable<T>::simplify(Simplifier<T>&) const {
+    return std::const_pointer_cast<BaseExpr<T>>(this->shared_from_this());
 }
 
 template class Variable<RealNumber>;
+template class Variable<double>;
+template class Variable<float>;
 template class Variable<ComplexNumber>;
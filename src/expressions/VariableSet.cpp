@@ -0,0 +1,78 @@
+#include "expressions.hpp"
+
+#include <functional>
+#include <shared_mutex>
+
+namespace {
+
+constexpr std::uint32_t INLINE_BITS = 64;
+
+struct NameHash {
+    using is_transparent = void;
+
+    std::size_t operator()(const std::string_view name) const {
+        return std::hash<std::string_view>{}(name);
+    }
+};
+
+// Names are looked up on every `Variable` probe, so lookups share the lock
+struct VariableIds {
+    std::shared_mutex mutex;
+    std::unordered_map<std::string, std::uint32_t, NameHash, std::equal_to<>> ids;
+};
+
+VariableIds& variable_ids() {
+    // Never destroyed, like the intern tables whose nodes hold ids
+    static VariableIds* table = new VariableIds;
+    return *table;
+}
+
+}  // namespace
+
+std::uint32_t VariableSet::id(const std::string_view name) {
+    VariableIds& table = variable_ids();
+    {
+        std::shared_lock lock(table.mutex);
+        if (const auto it = table.ids.find(name); it != table.ids.end()) {
+            return it->second;
+        }
+    }
+    std::unique_lock lock(table.mutex);
+    const auto next = static_cast<std::uint32_t>(table.ids.size());
+    return table.ids.emplace(std::string(name), next).first->second;
+}
+
+VariableSet VariableSet::of(const std::uint32_t id) {
+    VariableSet set;
+    if (id < INLINE_BITS) {
+        set.inline_bits = std::uint64_t(1) << id;
+    } else {
+        const std::uint32_t bit = id - INLINE_BITS;
+        set.overflow_bits.resize(bit / 64 + 1);
+        set.overflow_bits.back() = std::uint64_t(1) << (bit % 64);
+    }
+    return set;
+}
+
+bool VariableSet::contains(const std::uint32_t id) const {
+    if (id < INLINE_BITS) {
+        return (inline_bits >> id) & 1;
+    }
+    const std::uint32_t bit = id - INLINE_BITS;
+    return bit / 64 < overflow_bits.size() && ((overflow_bits[bit / 64] >> (bit % 64)) & 1);
+}
+
+bool VariableSet::empty() const {
+    return inline_bits == 0 && overflow_bits.empty();
+}
+
+VariableSet& VariableSet::operator|=(const VariableSet& other) {
+    inline_bits |= other.inline_bits;
+    if (overflow_bits.size() < other.overflow_bits.size()) {
+        overflow_bits.resize(other.overflow_bits.size());
+    }
+    for (std::size_t i = 0; i < other.overflow_bits.size(); ++i) {
+        overflow_bits[i] |= other.overflow_bits[i];
+    }
+    return *this;
+}
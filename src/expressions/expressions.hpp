@@ -1,10 +1,21 @@
 #ifndef EXPRESSIONS_HPP
 #define EXPRESSIONS_HPP
 
+#include <array>
 #include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 using RealNumber = long double;
 using ComplexNumber = std::complex<long double>;
@@ -13,25 +24,326 @@ enum class OpPrecedence {
     AddSub = 0,
     Mul = 1,
     Div = 2,
-    Pow = 3
+    Pow = 3,
+    Atom = 4
+};
+
+enum class OpCode : std::uint8_t {
+    Const,
+    Var,
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Pow,
+    Sin,
+    Cos,
+    Ln,
+    Exp
 };
 
 template <typename T> class Parser;
+template <typename T> class TapeBuilder;
+template <typename T> class CompiledExpression;
+template <typename T> class Simplifier;
+template <typename T> class DiffCache;
+template <typename T> struct Dual;
+template <typename T> class Jacobian;
+template <typename T> class IncrementalEvaluator;
+
+inline std::size_t hash_combine(const std::size_t seed, const std::size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+template <typename T> class InternTable;
+class NodeArena;
+
+/// Set of variables, as process-wide ids handed out by `id`. Ids below 64 are stored inline,
+/// so sets over the first 64 variable names ever seen need no allocation.
+class VariableSet {
+public:
+    VariableSet() = default;
+
+    /// Id of a variable name; the first name seen gets 0. Ids are never released or reused.
+    static std::uint32_t id(std::string_view name);
+    static VariableSet of(std::uint32_t id);
+
+    bool contains(std::uint32_t id) const;
+    bool empty() const;
+    VariableSet& operator|=(const VariableSet& other);
+
+private:
+    std::uint64_t inline_bits = 0;
+    // Bits of ids 64 and up, without trailing zero words
+    std::vector<std::uint64_t> overflow_bits;
+};
 
 template<typename T>
-class BaseExpr {
+class BaseExpr : public std::enable_shared_from_this<BaseExpr<T>> {
 public:
+    using value_type = T;
+
     virtual std::shared_ptr<BaseExpr> with_values(
         const std::unordered_map<std::string, T>& values
     ) const = 0;
 
     virtual T resolve() const = 0;
-    virtual std::shared_ptr<BaseExpr> diff(const std::string& by) const = 0;
-    virtual std::string to_string() const = 0;
+    /// Returns the derivative by `by`; children are differentiated through `cache`.
+    virtual std::shared_ptr<BaseExpr> diff(const std::string& by, DiffCache<T>& cache) const = 0;
+
+    /// Writes the expression to `out`, parenthesizing operands that bind weaker than their operator.
+    virtual void print(std::ostream& out) const = 0;
+    /// How tightly the node binds as an operand; only binary operators are not atomic.
+    virtual OpPrecedence precedence() const = 0;
+    std::string to_string() const;
+
+    /// Emits the node into `builder` and returns the register holding its value.
+    virtual std::uint32_t compile(TapeBuilder<T>& builder) const = 0;
+
+    /// Returns an algebraically simplified copy; children are simplified through `simplifier`.
+    virtual std::shared_ptr<BaseExpr> simplify(Simplifier<T>& simplifier) const = 0;
+
+    /// Structural hash and equality. Children are compared by identity,
+    /// which is structural equality for nodes built with `make_node`.
+    virtual std::size_t hash() const = 0;
+    virtual bool equals(const BaseExpr& other) const = 0;
+
+    /// Variables the node depends on, summarized once when it is built. Lets differentiation,
+    /// simplification and substitution skip subtrees that do not involve a variable.
+    const VariableSet& dependencies() const;
 
 protected:
     BaseExpr() = default;
-    virtual ~BaseExpr() = default;
+    // Copies are new, not yet interned nodes
+    BaseExpr(const BaseExpr& other)
+        : std::enable_shared_from_this<BaseExpr>(), variable_dependencies(other.variable_dependencies) {}
+    virtual ~BaseExpr();
+
+    /// Drops a reference to a child. Children freed by it are destroyed in a loop rather than
+    /// from their parent's destructor, so releasing a deep graph does not grow the stack.
+    static void release(std::shared_ptr<BaseExpr>& child);
+
+    VariableSet variable_dependencies;
+
+private:
+    std::size_t intern_hash = 0;
+    bool interned = false;
+    // Arena the node was allocated from, nullptr for the regular heap
+    const NodeArena* arena = nullptr;
+
+    friend class InternTable<T>;
+};
+
+/// Process-wide hash-consing table: structurally identical live nodes are shared. Sharing is scoped
+/// to where nodes are stored: a node on the heap is only found for a heap build and a node in an
+/// arena only for a build in the same arena, so no node ever keeps a foreign arena alive.
+/// Nodes unregister themselves when destroyed, so the table never keeps memory alive.
+template<typename T>
+class InternTable {
+public:
+    static InternTable& instance();
+
+    /// Finds a live node equal to `probe` that is stored in `arena` (nullptr for the heap).
+    std::shared_ptr<BaseExpr<T>> find(const BaseExpr<T>& probe, const NodeArena* arena);
+    void insert(const std::shared_ptr<BaseExpr<T>>& node, const NodeArena* arena);
+    void erase(const BaseExpr<T>* node);
+
+    std::size_t size() const;
+
+private:
+    static constexpr std::size_t SHARD_COUNT = 64;
+
+    // Sharded by hash so that threads building expressions rarely contend
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_multimap<std::size_t, BaseExpr<T>*> nodes;
+    };
+
+    std::array<Shard, SHARD_COUNT> shards;
+
+    InternTable() = default;
+
+    Shard& shard_for(std::size_t hash);
+};
+
+struct ArenaStats {
+    std::size_t nodes;
+    std::size_t bytes_used;
+    std::size_t bytes_reserved;
+    std::size_t blocks;
+
+    double bytes_per_node() const;
+};
+
+/// Bump allocator for expression nodes. Nodes keep their arena alive, and its blocks are released
+/// in bulk once the last handle and the last node allocated from it are gone. Nodes are only shared
+/// within one arena, so builds elsewhere never pick up its nodes; a node built elsewhere on top of
+/// them (e.g. on the heap, from an expression parsed in the arena) does keep it alive, though.
+/// An arena must not be allocated from by several threads at once.
+class NodeArena {
+public:
+    explicit NodeArena(std::size_t block_size = 64 * 1024);
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+
+    void* allocate(std::size_t bytes, std::size_t alignment);
+    ArenaStats stats() const;
+
+    /// Arena `make_node` allocates from on this thread, nullptr for the regular heap.
+    static const std::shared_ptr<NodeArena>& current();
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t size;
+    };
+
+    std::vector<Block> blocks;
+    std::size_t block_size;
+    std::size_t offset = 0;
+    std::size_t nodes = 0;
+    std::size_t bytes_used = 0;
+    std::size_t bytes_reserved = 0;
+
+    static std::shared_ptr<NodeArena>& current_slot();
+
+    friend class ArenaScope;
+};
+
+/// Makes `arena` the current arena of this thread until the scope ends.
+class ArenaScope {
+public:
+    explicit ArenaScope(std::shared_ptr<NodeArena> arena);
+    ~ArenaScope();
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    std::shared_ptr<NodeArena> previous;
+};
+
+template<typename U>
+class ArenaAllocator {
+public:
+    using value_type = U;
+
+    explicit ArenaAllocator(std::shared_ptr<NodeArena> _arena) : arena(std::move(_arena)) {}
+
+    template<typename V>
+    ArenaAllocator(const ArenaAllocator<V>& other) : arena(other.arena) {}
+
+    U* allocate(const std::size_t n) {
+        return static_cast<U*>(arena->allocate(n * sizeof(U), alignof(U)));
+    }
+
+    void deallocate(U*, std::size_t) noexcept {}
+
+    template<typename V>
+    bool operator==(const ArenaAllocator<V>& other) const {
+        return arena == other.arena;
+    }
+
+private:
+    std::shared_ptr<NodeArena> arena;
+
+    template<typename V> friend class ArenaAllocator;
+};
+
+/// Every node is built through `make_node`, so identical subexpressions become one node.
+/// New nodes are allocated from the current `NodeArena`, if there is one, and are shared only
+/// with other nodes of that arena.
+template<typename Node, typename... Args>
+std::shared_ptr<Node> make_node(Args&&... args) {
+    using T = typename Node::value_type;
+
+    Node probe(std::forward<Args>(args)...);
+    InternTable<T>& table = InternTable<T>::instance();
+    const auto& arena = NodeArena::current();
+    if (auto existing = table.find(probe, arena.get())) {
+        return std::static_pointer_cast<Node>(existing);
+    }
+
+    std::shared_ptr<Node> node;
+    if (arena) {
+        node = std::allocate_shared<Node>(ArenaAllocator<Node>(arena), std::move(probe));
+    } else {
+        node = std::make_shared<Node>(std::move(probe));
+    }
+    table.insert(node, arena.get());
+    return node;
+}
+
+/// Rewrites a graph bottom-up: constant folding, identity and annihilator removal,
+/// like-term and power collection. Each shared node is simplified once per simplifier.
+template<typename T>
+class Simplifier {
+public:
+    std::shared_ptr<BaseExpr<T>> simplify(const std::shared_ptr<BaseExpr<T>>& node);
+
+    static std::optional<T> constant_value(const std::shared_ptr<BaseExpr<T>>& node);
+    static bool is_constant(const std::shared_ptr<BaseExpr<T>>& node, T value);
+
+    /// Returns nullptr when `value` can not be held by a single `Constant` (non-finite values,
+    /// complex numbers with both parts set).
+    static std::shared_ptr<BaseExpr<T>> make_constant(T value);
+
+    /// Splits `c * term` into `{c, term}` and `c / term` into `{c, 1 / term}`; `term` is nullptr for constants.
+    static std::pair<T, std::shared_ptr<BaseExpr<T>>> split_coefficient(const std::shared_ptr<BaseExpr<T>>& node);
+    /// Splits `base ^ exponent` into `{base, exponent}` and `1 / term` into `{base, -exponent}`.
+    static std::pair<std::shared_ptr<BaseExpr<T>>, std::shared_ptr<BaseExpr<T>>> split_power(
+        const std::shared_ptr<BaseExpr<T>>& node
+    );
+    /// Builds `coefficient * term`, the inverse of `split_coefficient`.
+    static std::shared_ptr<BaseExpr<T>> scale(T coefficient, const std::shared_ptr<BaseExpr<T>>& term);
+
+private:
+    std::unordered_map<const BaseExpr<T>*, std::shared_ptr<BaseExpr<T>>> simplified;
+};
+
+/// Memoizes derivatives by (node, variable), so a subterm shared within an expression or across
+/// derivatives of it is differentiated once. Differentiated nodes are kept alive by the cache,
+/// which makes node identity a valid key for as long as the entry exists. A cache with a size
+/// limit is cleared whenever an insertion would exceed it.
+template<typename T>
+class DiffCache {
+public:
+    explicit DiffCache(std::size_t max_entries = 0);
+
+    std::shared_ptr<BaseExpr<T>> diff(const std::shared_ptr<BaseExpr<T>>& node, const std::string& by);
+
+    void clear();
+    std::size_t size() const;
+
+    /// 0 means unlimited. Lowering the limit below the current size clears the cache.
+    std::size_t max_size() const;
+    void set_max_size(std::size_t max_entries);
+
+    std::size_t hits() const;
+    std::size_t misses() const;
+
+    /// The derivative of every node that does not depend on the variable. Such nodes are
+    /// answered without being visited or cached.
+    const std::shared_ptr<BaseExpr<T>>& zero() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<BaseExpr<T>> node;
+        std::shared_ptr<BaseExpr<T>> derivative;
+    };
+
+    struct ByVariable {
+        std::uint32_t id;
+        // Differentiated node -> derivative
+        std::unordered_map<const BaseExpr<T>*, Entry> nodes;
+    };
+
+    std::unordered_map<std::string, ByVariable> derivatives;
+    std::shared_ptr<BaseExpr<T>> zero_node;
+    std::size_t entries = 0;
+    std::size_t max_entries;
+    std::size_t hit_count = 0;
+    std::size_t miss_count = 0;
 };
 
 template<typename T = RealNumber>
@@ -40,7 +352,16 @@ public:
     explicit Expression(T number);
     explicit Expression(const std::string& var_name);
 
-    static Expression from_string(const std::string& expression_str, bool case_sensitive = false);
+    /// The text is only read while parsing; the expression keeps no reference to it.
+    static Expression from_string(std::string_view expression_str, bool case_sensitive = false);
+    /// Parses the text of a file through a read-only memory mapping, without copying it.
+    static Expression from_file(const std::filesystem::path& path, bool case_sensitive = false);
+    /// Rebuilds the graph of a compiled expression, one node per instruction.
+    static Expression from_compiled(const CompiledExpression<T>& compiled);
+
+    /// Writes `compile()` in the binary format of `CompiledExpression::serialize`.
+    void save(const std::filesystem::path& path) const;
+    static Expression load(const std::filesystem::path& path);
 
     Expression sin() const;
     Expression cos() const;
@@ -68,10 +389,44 @@ public:
 
     T resolve() const;
     T resolve_with(std::unordered_map<std::string, T>& values) const;
-
-    Expression diff(const std::string& by) const;
+    void resolve_batch(
+        const std::unordered_map<std::string, std::span<const T>>& columns,
+        std::span<T> out
+    ) const;
+    T gradient(
+        const std::unordered_map<std::string, T>& values,
+        std::unordered_map<std::string, T>& partials
+    ) const;
+
+    /// Value and derivative by `by` in one forward pass, without building the derivative expression.
+    Dual<T> resolve_dual(const std::unordered_map<std::string, T>& values, const std::string& by) const;
+    /// Value and derivative along `direction`; variables missing from `direction` have a zero component.
+    Dual<T> resolve_dual(
+        const std::unordered_map<std::string, T>& values,
+        const std::unordered_map<std::string, T>& direction
+    ) const;
+
+    /// Value and derivatives of orders 1..`order` by `by` at `values`, computed numerically in Taylor mode.
+    std::vector<T> derivatives(
+        const std::unordered_map<std::string, T>& values,
+        const std::string& by,
+        std::size_t order
+    ) const;
+
+    Expression diff(const std::string& by, bool simplified = true) const;
+    /// Reuses derivatives of subterms already in `cache`, e.g. from lower orders or other variables.
+    Expression diff(const std::string& by, DiffCache<T>& cache, bool simplified = true) const;
+    Expression simplify() const;
+
+    CompiledExpression<T> compile() const;
+    /// Compiles with `variables[i]` bound to slot `i` of the values passed to `evaluate`.
+    /// Throws if the expression uses a variable not in the list or the list names one twice. Listed
+    /// variables the expression does not use keep their slots, so that e.g. a function and its
+    /// derivatives can share one layout.
+    CompiledExpression<T> bind(const std::vector<std::string>& variables) const;
 
     std::string to_string() const;
+    void print(std::ostream& out) const;
 
 private:
     std::shared_ptr<BaseExpr<T>> inner;
@@ -79,6 +434,7 @@ private:
     explicit Expression(std::shared_ptr<BaseExpr<T>> expression_impl);
 
     friend class Parser<T>;
+    friend class Jacobian<T>;
 };
 
 template<typename T>
@@ -91,8 +447,15 @@ public:
     ) const override;
 
     T resolve() const override;
-    std::shared_ptr<BaseExpr<T>> diff(const std::string& by) const override;
-    std::string to_string() const override;
+    std::shared_ptr<BaseExpr<T>> diff(const std::string& by, DiffCache<T>& cache) const override;
+    void print(std::ostream& out) const override;
+    OpPrecedence precedence() const override;
+    std::uint32_t compile(TapeBuilder<T>& builder) const override;
+    std::size_t hash() const override;
+    bool equals(const BaseExpr<T>& other) const override;
+    std::shared_ptr<BaseExpr<T>> simplify(Simplifier<T>& simplifier) const override;
+
+    T get_value() const;
 
 private:
     T value;
@@ -108,8 +471,13 @@ public:
     ) const override;
 
     T resolve() const override;
-    std::shared_ptr<BaseExpr<T>> diff(const std::string& by) const override;
-    std::string to_string() const override;
+    std::shared_ptr<BaseExpr<T>> diff(const std::string& by, DiffCache<T>& cache) const override;
+    void print(std::ostream& out) const override;
+    OpPrecedence precedence() const override;
+    std::uint32_t compile(TapeBuilder<T>& builder) const override;
+    std::size_t hash() const override;
+    bool equals(const BaseExpr<T>& other) const override;
+    std::shared_ptr<BaseExpr<T>> simplify(Simplifier<T>& simplifier) const override;
 
 private:
     std::string name;
@@ -124,14 +492,16 @@ public:
     );
 
     static std::shared_ptr<BinOp> from_name(
-        const std::string& name,
+        std::string_view name,
         const std::shared_ptr<BaseExpr<T>>& _lhs,
         const std::shared_ptr<BaseExpr<T>>& _rhs
     );
-    static OpPrecedence get_precedence_by_name(const std::string& name);
+    static OpPrecedence get_precedence_by_name(std::string_view name);
 
-    virtual OpPrecedence precedence() const = 0;
-    virtual std::string name() const = 0;
+    ~BinOp() override;
+
+    const std::shared_ptr<BaseExpr<T>>& get_lhs() const;
+    const std::shared_ptr<BaseExpr<T>>& get_rhs() const;
 
 protected:
     std::shared_ptr<BaseExpr<T>> lhs;
@@ -147,8 +517,19 @@ public:
         const std::unordered_map<std::string, T>& values
     ) const override;
 
+    void print(std::ostream& out) const override;
     OpPrecedence precedence() const override;
-    std::string to_string() const override;
+    std::uint32_t compile(TapeBuilder<T>& builder) const override;
+    std::size_t hash() const override;
+    bool equals(const BaseExpr<T>& other) const override;
+    std::shared_ptr<BaseExpr<T>> simplify(Simplifier<T>& simplifier) const override;
+
+    /// Evaluates the operator on two constants; nullptr if either side is not constant
+    /// or the result is not representable.
+    static std::shared_ptr<BaseExpr<T>> fold(
+        const std::shared_ptr<BaseExpr<T>>& lhs,
+        const std::shared_ptr<BaseExpr<T>>& rhs
+    );
 };
 
 template<typename T>
@@ -161,7 +542,9 @@ public:
         const std::shared_ptr<BaseExpr<T>>& _argument
     );
 
-    virtual std::string name() const = 0;
+    ~Func() override;
+
+    const std::shared_ptr<BaseExpr<T>>& get_argument() const;
 
 protected:
     std::shared_ptr<BaseExpr<T>> argument;
@@ -176,7 +559,12 @@ public:
         const std::unordered_map<std::string, T>& values
     ) const override;
 
-    std::string to_string() const override;
+    void print(std::ostream& out) const override;
+    OpPrecedence precedence() const override;
+    std::uint32_t compile(TapeBuilder<T>& builder) const override;
+    std::size_t hash() const override;
+    bool equals(const BaseExpr<T>& other) const override;
+    std::shared_ptr<BaseExpr<T>> simplify(Simplifier<T>& simplifier) const override;
 };
 
 template<typename T>
@@ -184,13 +572,17 @@ class AddOp final : public BinOpImpl<T, AddOp<T>> {
 public:
     using BinOpImpl<T, AddOp>::BinOpImpl;
 
+    static constexpr OpCode op_code = OpCode::Add;
+    static constexpr std::string_view symbol = "+";
+    static constexpr OpPrecedence op_precedence = OpPrecedence::AddSub;
+
     T resolve() const override;
-    std::shared_ptr<BaseExpr<T>> diff(const std::string& by) const override;
+    std::shared_ptr<BaseExpr<T>> diff(const std::string& by, DiffCache<T>& cache) const override;
 
-private:
-    std::string name() const override {
-        return "+";
-    }
+    static std::shared_ptr<BaseExpr<T>> simplified(
+        const std::shared_ptr<BaseExpr<T>>& lhs,
+        const std::shared_ptr<BaseExpr<T>>& rhs
+    );
 };
 
 template<typename T>
@@ -198,13 +590,17 @@ class SubOp final : public BinOpImpl<T, SubOp<T>> {
 public:
     using BinOpImpl<T, SubOp>::BinOpImpl;
 
+    static constexpr OpCode op_code = OpCode::Sub;
+    static constexpr std::string_view symbol = "-";
+    static constexpr OpPrecedence op_precedence = OpPrecedence::AddSub;
+
     T resolve() const override;
-    std::shared_ptr<BaseExpr<T>> diff(const std::string& by) const override;
+    std::shared_ptr<BaseExpr<T>> diff(const std::string& by, DiffCache<T>& cache) const override;
 
-private:
-    std::string name() const override {
-        return "-";
-    }
+    static std::shared_ptr<BaseExpr<T>> simplified(
+        const std::shared_ptr<BaseExpr<T>>& lhs,
+        const std::shared_ptr<BaseExpr<T>>& rhs
+    );
 };
 
 template<typename T>
@@ -212,13 +608,17 @@ class MulOp final : public BinOpImpl<T, MulOp<T>> {
 public:
     using BinOpImpl<T, MulOp>::BinOpImpl;
 
+    static constexpr OpCode op_code = OpCode::Mul;
+    static constexpr std::string_view symbol = "*";
+    static constexpr OpPrecedence op_precedence = OpPrecedence::Mul;
+
     T resolve() const override;
-    std::shared_ptr<BaseExpr<T>> diff(const std::string& by) const override;
+    std::shared_ptr<BaseExpr<T>> diff(const std::string& by, DiffCache<T>& cache) const override;
 
-private:
-    std::string name() const override {
-        return "*";
-    }
+    static std::shared_ptr<BaseExpr<T>> simplified(
+        const std::shared_ptr<BaseExpr<T>>& lhs,
+        const std::shared_ptr<BaseExpr<T>>& rhs
+    );
 };
 
 template<typename T>
@@ -226,13 +626,17 @@ class DivOp final : public BinOpImpl<T, DivOp<T>> {
 public:
     using BinOpImpl<T, DivOp>::BinOpImpl;
 
+    static constexpr OpCode op_code = OpCode::Div;
+    static constexpr std::string_view symbol = "/";
+    static constexpr OpPrecedence op_precedence = OpPrecedence::Div;
+
     T resolve() const override;
-    std::shared_ptr<BaseExpr<T>> diff(const std::string& by) const override;
+    std::shared_ptr<BaseExpr<T>> diff(const std::string& by, DiffCache<T>& cache) const override;
 
-private:
-    std::string name() const override {
-        return "/";
-    }
+    static std::shared_ptr<BaseExpr<T>> simplified(
+        const std::shared_ptr<BaseExpr<T>>& lhs,
+        const std::shared_ptr<BaseExpr<T>>& rhs
+    );
 };
 
 template<typename T>
@@ -240,13 +644,17 @@ class PowOp final : public BinOpImpl<T, PowOp<T>> {
 public:
     using BinOpImpl<T, PowOp>::BinOpImpl;
 
+    static constexpr OpCode op_code = OpCode::Pow;
+    static constexpr std::string_view symbol = "^";
+    static constexpr OpPrecedence op_precedence = OpPrecedence::Pow;
+
     T resolve() const override;
-    std::shared_ptr<BaseExpr<T>> diff(const std::string& by) const override;
+    std::shared_ptr<BaseExpr<T>> diff(const std::string& by, DiffCache<T>& cache) const override;
 
-private:
-    std::string name() const override {
-        return "^";
-    }
+    static std::shared_ptr<BaseExpr<T>> simplified(
+        const std::shared_ptr<BaseExpr<T>>& lhs,
+        const std::shared_ptr<BaseExpr<T>>& rhs
+    );
 };
 
 template<typename T>
@@ -254,13 +662,11 @@ class SinFunc final : public FuncImpl<T, SinFunc<T>> {
 public:
     using FuncImpl<T, SinFunc>::FuncImpl;
 
-    T resolve() const override;
-    std::shared_ptr<BaseExpr<T>> diff(const std::string& by) const override;
+    static constexpr OpCode op_code = OpCode::Sin;
+    static constexpr std::string_view symbol = "sin";
 
-private:
-    std::string name() const override {
-        return "sin";
-    }
+    T resolve() const override;
+    std::shared_ptr<BaseExpr<T>> diff(const std::string& by, DiffCache<T>& cache) const override;
 };
 
 template<typename T>
@@ -268,13 +674,11 @@ class CosFunc final : public FuncImpl<T, CosFunc<T>> {
 public:
     using FuncImpl<T, CosFunc>::FuncImpl;
 
-    T resolve() const override;
-    std::shared_ptr<BaseExpr<T>> diff(const std::string& by) const override;
+    static constexpr OpCode op_code = OpCode::Cos;
+    static constexpr std::string_view symbol = "cos";
 
-private:
-    std::string name() const override {
-        return "cos";
-    }
+    T resolve() const override;
+    std::shared_ptr<BaseExpr<T>> diff(const std::string& by, DiffCache<T>& cache) const override;
 };
 
 template<typename T>
@@ -282,13 +686,11 @@ class LnFunc final : public FuncImpl<T, LnFunc<T>> {
 public:
     using FuncImpl<T, LnFunc>::FuncImpl;
 
-    T resolve() const override;
-    std::shared_ptr<BaseExpr<T>> diff(const std::string& by) const override;
+    static constexpr OpCode op_code = OpCode::Ln;
+    static constexpr std::string_view symbol = "ln";
 
-private:
-    constexpr std::string name() const override {
-        return "ln";
-    }
+    T resolve() const override;
+    std::shared_ptr<BaseExpr<T>> diff(const std::string& by, DiffCache<T>& cache) const override;
 };
 
 template<typename T>
@@ -296,13 +698,11 @@ class ExpFunc final : public FuncImpl<T, ExpFunc<T>> {
 public:
     using FuncImpl<T, ExpFunc>::FuncImpl;
 
-    T resolve() const override;
-    std::shared_ptr<BaseExpr<T>> diff(const std::string& by) const override;
+    static constexpr OpCode op_code = OpCode::Exp;
+    static constexpr std::string_view symbol = "exp";
 
-private:
-    std::string name() const override {
-        return "exp";
-    }
+    T resolve() const override;
+    std::shared_ptr<BaseExpr<T>> diff(const std::string& by, DiffCache<T>& cache) const override;
 };
 
 #endif  // EXPRESSIONS_HPP
@@ -8,15 +8,17 @@ T CosFunc<T>::resolve() const {
 }
 
 template<typename T>
-std::shared_ptr<BaseExpr<T>> CosFunc<T>::diff(const std::string& by) const {
-    return std::make_shared<MulOp<T>>(
-        std::make_shared<MulOp<T>>(
-            std::make_shared<Constant<T>>(-1),
-            std::make_shared<SinFunc<T>>(this->argument)
+std::shared_ptr<BaseExpr<T>> CosFunc<T>::diff(const std::string& by, DiffCache<T>& cache) const {
+    return make_node<MulOp<T>>(
+        make_node<MulOp<T>>(
+            make_node<Constant<T>>(-1),
+            make_node<SinFunc<T>>(this->argument)
         ),
-        this->argument->diff(by)
+        cache.diff(this->argument, by)
     );
 }
 
 template class CosFunc<RealNumber>;
+template class CosFunc<double>;
+template class CosFunc<float>;
 template class CosFunc<ComplexNumber>;
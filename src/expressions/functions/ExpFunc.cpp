@@ -8,12 +8,14 @@ T ExpFunc<T>::resolve() const {
 }
 
 template<typename T>
-std::shared_ptr<BaseExpr<T>> ExpFunc<T>::diff(const std::string& by) const {
-    return std::make_shared<MulOp<T>>(
-        std::make_shared<ExpFunc>(*this),
-        this->argument->diff(by)
+std::shared_ptr<BaseExpr<T>> ExpFunc<T>::diff(const std::string& by, DiffCache<T>& cache) const {
+    return make_node<MulOp<T>>(
+        make_node<ExpFunc>(this->argument),
+        cache.diff(this->argument, by)
     );
 }
 
 template class ExpFunc<RealNumber>;
+template class ExpFunc<double>;
+template class ExpFunc<float>;
 template class ExpFunc<ComplexNumber>;
@@ -1,11 +1,15 @@
 #include "../expressions.hpp"
+#include "../../tape/Tape.hpp"
 
 #include <format>
+#include <functional>
 
 template<typename T>
 Func<T>::Func(
     const std::shared_ptr<BaseExpr<T>>& _argument
-) : argument(_argument) {}
+) : argument(_argument) {
+    this->variable_dependencies = argument->dependencies();
+}
 
 template<typename T>
 std::shared_ptr<Func<T>> Func<T>::from_name(
@@ -13,43 +17,104 @@ std::shared_ptr<Func<T>> Func<T>::from_name(
     const std::shared_ptr<BaseExpr<T>>& _argument
 ) {
     if (name == "sin") {
-        return std::make_shared<SinFunc<T>>(_argument);
+        return make_node<SinFunc<T>>(_argument);
     }
     if (name == "cos") {
-        return std::make_shared<CosFunc<T>>(_argument);
+        return make_node<CosFunc<T>>(_argument);
     }
     if (name == "ln") {
-        return std::make_shared<LnFunc<T>>(_argument);
+        return make_node<LnFunc<T>>(_argument);
     }
     if (name == "exp") {
-        return std::make_shared<ExpFunc<T>>(_argument);
+        return make_node<ExpFunc<T>>(_argument);
     }
     throw std::runtime_error(std::format("Unknown function: \"{}\"", name));
 }
 
+template<typename T>
+Func<T>::~Func() {
+    BaseExpr<T>::release(argument);
+}
+
+template<typename T>
+const std::shared_ptr<BaseExpr<T>>& Func<T>::get_argument() const {
+    return argument;
+}
+
 template<typename T, typename Derived>
 std::shared_ptr<BaseExpr<T>> FuncImpl<T, Derived>::with_values(
     const std::unordered_map<std::string, T>& values
 ) const {
-    return std::make_shared<Derived>(this->argument->with_values(values));
+    // Nothing to substitute in a subtree without variables, so it is shared as it is
+    if (this->dependencies().empty()) {
+        return std::const_pointer_cast<BaseExpr<T>>(this->shared_from_this());
+    }
+    return make_node<Derived>(this->argument->with_values(values));
+}
+
+template<typename T, typename Derived>
+void FuncImpl<T, Derived>::print(std::ostream& out) const {
+    out << Derived::symbol << '(';
+    this->argument->print(out);
+    out << ')';
+}
+
+template<typename T, typename Derived>
+OpPrecedence FuncImpl<T, Derived>::precedence() const {
+    return OpPrecedence::Atom;
+}
+
+template<typename T, typename Derived>
+std::size_t FuncImpl<T, Derived>::hash() const {
+    return hash_combine(
+        static_cast<std::size_t>(Derived::op_code),
+        std::hash<const BaseExpr<T>*>{}(this->argument.get())
+    );
+}
+
+template<typename T, typename Derived>
+bool FuncImpl<T, Derived>::equals(const BaseExpr<T>& other) const {
+    const auto* expr = dynamic_cast<const Derived*>(&other);
+    return expr != nullptr && expr->argument == this->argument;
+}
+
+template<typename T, typename Derived>
+std::uint32_t FuncImpl<T, Derived>::compile(TapeBuilder<T>& builder) const {
+    return builder.emit(Derived::op_code, builder.lower(this->argument));
 }
 
 template<typename T, typename Derived>
-std::string FuncImpl<T, Derived>::to_string() const {
-    return std::format("{}({})", this->name(), this->argument->to_string());
+std::shared_ptr<BaseExpr<T>> FuncImpl<T, Derived>::simplify(Simplifier<T>& simplifier) const {
+    auto simplified_argument = simplifier.simplify(this->argument);
+    if (Simplifier<T>::constant_value(simplified_argument)) {
+        if (auto folded = Simplifier<T>::make_constant(Derived(simplified_argument).resolve())) {
+            return folded;
+        }
+    }
+    return make_node<Derived>(simplified_argument);
 }
 
 template class Func<RealNumber>;
+template class Func<double>;
+template class Func<float>;
 template class Func<ComplexNumber>;
 
 template class FuncImpl<RealNumber, SinFunc<RealNumber>>;
+template class FuncImpl<double, SinFunc<double>>;
+template class FuncImpl<float, SinFunc<float>>;
 template class FuncImpl<ComplexNumber, SinFunc<ComplexNumber>>;
 
 template class FuncImpl<RealNumber, CosFunc<RealNumber>>;
+template class FuncImpl<double, CosFunc<double>>;
+template class FuncImpl<float, CosFunc<float>>;
 template class FuncImpl<ComplexNumber, CosFunc<ComplexNumber>>;
 
 template class FuncImpl<RealNumber, LnFunc<RealNumber>>;
+template class FuncImpl<double, LnFunc<double>>;
+template class FuncImpl<float, LnFunc<float>>;
 template class FuncImpl<ComplexNumber, LnFunc<ComplexNumber>>;
 
 template class FuncImpl<RealNumber, ExpFunc<RealNumber>>;
+template class FuncImpl<double, ExpFunc<double>>;
+template class FuncImpl<float, ExpFunc<float>>;
 template class FuncImpl<ComplexNumber, ExpFunc<ComplexNumber>>;
@@ -8,15 +8,17 @@ T LnFunc<T>::resolve() const {
 }
 
 template<typename T>
-std::shared_ptr<BaseExpr<T>> LnFunc<T>::diff(const std::string& by) const {
-    return std::make_shared<MulOp<T>>(
-        std::make_shared<DivOp<T>>(
-            std::make_shared<Constant<T>>(1),
+std::shared_ptr<BaseExpr<T>> LnFunc<T>::diff(const std::string& by, DiffCache<T>& cache) const {
+    return make_node<MulOp<T>>(
+        make_node<DivOp<T>>(
+            make_node<Constant<T>>(1),
             this->argument
         ),
-        this->argument->diff(by)
+        cache.diff(this->argument, by)
     );
 }
 
 template class LnFunc<RealNumber>;
+template class LnFunc<double>;
+template class LnFunc<float>;
 template class LnFunc<ComplexNumber>;
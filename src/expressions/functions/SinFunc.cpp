@@ -8,12 +8,14 @@ T SinFunc<T>::resolve() const {
 }
 
 template<typename T>
-std::shared_ptr<BaseExpr<T>> SinFunc<T>::diff(const std::string& by) const {
-    return std::make_shared<MulOp<T>>(
-        std::make_shared<CosFunc<T>>(this->argument),
-        this->argument->diff(by)
+std::shared_ptr<BaseExpr<T>> SinFunc<T>::diff(const std::string& by, DiffCache<T>& cache) const {
+    return make_node<MulOp<T>>(
+        make_node<CosFunc<T>>(this->argument),
+        cache.diff(this->argument, by)
     );
 }
 
 template class SinFunc<RealNumber>;
+template class SinFunc<double>;
+template class SinFunc<float>;
 template class SinFunc<ComplexNumber>;
@@ -6,12 +6,46 @@ T AddOp<T>::resolve() const {
 }
 
 template<typename T>
-std::shared_ptr<BaseExpr<T>> AddOp<T>::diff(const std::string& by) const {
-    return std::make_shared<AddOp>(
-        this->lhs->diff(by),
-        this->rhs->diff(by)
-    );
+std::shared_ptr<BaseExpr<T>> AddOp<T>::diff(const std::string& by, DiffCache<T>& cache) const {
+    auto lhs_derivative = cache.diff(this->lhs, by);
+    auto rhs_derivative = cache.diff(this->rhs, by);
+    // A side that does not depend on `by` contributes nothing
+    if (lhs_derivative == cache.zero()) {
+        return rhs_derivative;
+    }
+    if (rhs_derivative == cache.zero()) {
+        return lhs_derivative;
+    }
+    return make_node<AddOp>(lhs_derivative, rhs_derivative);
+}
+
+template<typename T>
+std::shared_ptr<BaseExpr<T>> AddOp<T>::simplified(
+    const std::shared_ptr<BaseExpr<T>>& lhs,
+    const std::shared_ptr<BaseExpr<T>>& rhs
+) {
+    if (auto folded = AddOp::fold(lhs, rhs)) {
+        return folded;
+    }
+    if (Simplifier<T>::is_constant(lhs, T(0))) {
+        return rhs;
+    }
+    if (Simplifier<T>::is_constant(rhs, T(0))) {
+        return lhs;
+    }
+
+    // a * x + b * x = (a + b) * x
+    const auto [lhs_coefficient, lhs_term] = Simplifier<T>::split_coefficient(lhs);
+    const auto [rhs_coefficient, rhs_term] = Simplifier<T>::split_coefficient(rhs);
+    if (lhs_term && lhs_term == rhs_term) {
+        if (auto collected = Simplifier<T>::scale(lhs_coefficient + rhs_coefficient, lhs_term)) {
+            return collected;
+        }
+    }
+    return make_node<AddOp>(lhs, rhs);
 }
 
 template class AddOp<RealNumber>;
+template class AddOp<double>;
+template class AddOp<float>;
 template class AddOp<ComplexNumber>;
@@ -1,15 +1,36 @@
 #include "../expressions.hpp"
+#include "../../tape/Tape.hpp"
 
 #include <format>
+#include <functional>
 
 template<typename T>
 BinOp<T>::BinOp(
     const std::shared_ptr<BaseExpr<T>>& _lhs,
     const std::shared_ptr<BaseExpr<T>>& _rhs
-) : lhs(_lhs), rhs(_rhs) {}
+) : lhs(_lhs), rhs(_rhs) {
+    this->variable_dependencies = lhs->dependencies();
+    this->variable_dependencies |= rhs->dependencies();
+}
+
+template<typename T>
+BinOp<T>::~BinOp() {
+    BaseExpr<T>::release(lhs);
+    BaseExpr<T>::release(rhs);
+}
+
+template<typename T>
+const std::shared_ptr<BaseExpr<T>>& BinOp<T>::get_lhs() const {
+    return lhs;
+}
 
 template<typename T>
-OpPrecedence BinOp<T>::get_precedence_by_name(const std::string& name) {
+const std::shared_ptr<BaseExpr<T>>& BinOp<T>::get_rhs() const {
+    return rhs;
+}
+
+template<typename T>
+OpPrecedence BinOp<T>::get_precedence_by_name(const std::string_view name) {
     if (name == "+" || name == "-") {
         return OpPrecedence::AddSub;
     }
@@ -27,76 +48,131 @@ OpPrecedence BinOp<T>::get_precedence_by_name(const std::string& name) {
 
 template<typename T>
 std::shared_ptr<BinOp<T>> BinOp<T>::from_name(
-    const std::string& name,
+    const std::string_view name,
     const std::shared_ptr<BaseExpr<T>>& _lhs,
     const std::shared_ptr<BaseExpr<T>>& _rhs
 ) {
     if (name == "+") {
-        return std::make_shared<AddOp<T>>(_lhs, _rhs);
+        return make_node<AddOp<T>>(_lhs, _rhs);
     }
     if (name == "-") {
-        return std::make_shared<SubOp<T>>(_lhs, _rhs);
+        return make_node<SubOp<T>>(_lhs, _rhs);
     }
     if (name == "*") {
-        return std::make_shared<MulOp<T>>(_lhs, _rhs);
+        return make_node<MulOp<T>>(_lhs, _rhs);
     }
     if (name == "/") {
-        return std::make_shared<DivOp<T>>(_lhs, _rhs);
+        return make_node<DivOp<T>>(_lhs, _rhs);
     }
     if (name == "^") {
-        return std::make_shared<PowOp<T>>(_lhs, _rhs);
+        return make_node<PowOp<T>>(_lhs, _rhs);
     }
     throw std::runtime_error(std::format("Unknown binary operator: \"{}\"", name));
 }
 
 template<typename T, typename Derived>
 OpPrecedence BinOpImpl<T, Derived>::precedence() const {
-    return BinOp<T>::get_precedence_by_name(this->name());
+    return Derived::op_precedence;
 }
 
 template<typename T, typename Derived>
 std::shared_ptr<BaseExpr<T>> BinOpImpl<T, Derived>::with_values(
     const std::unordered_map<std::string, T>& values
 ) const {
-    return std::make_shared<Derived>(
+    // Nothing to substitute in a subtree without variables, so it is shared as it is
+    if (this->dependencies().empty()) {
+        return std::const_pointer_cast<BaseExpr<T>>(this->shared_from_this());
+    }
+    return make_node<Derived>(
         this->lhs->with_values(values),
         this->rhs->with_values(values)
     );
 }
 
 template<typename T, typename Derived>
-std::string BinOpImpl<T, Derived>::to_string() const {
-    std::string lhs_str = this->lhs->to_string();
-    std::string rhs_str = this->rhs->to_string();
-
-    std::shared_ptr<BinOp<T>> expr;
-    if (((expr = std::dynamic_pointer_cast<BinOp<T>>(this->lhs))) &&
-        (expr->precedence() < this->precedence())) {
-        lhs_str = std::format("({})", lhs_str);
-    }
+void BinOpImpl<T, Derived>::print(std::ostream& out) const {
+    // The parser groups every operator to the left, so a right operand of equal precedence is
+    // enclosed: "x - (y - z)" needs it, and even for "+" and "*" regrouping would change the rounding.
+    // A left operand of "^" is enclosed as well, since "x ^ y ^ z" is commonly read from the right.
+    constexpr bool pow = Derived::op_code == OpCode::Pow;
+    const auto print_operand = [&out](const BaseExpr<T>& operand, const bool enclose_equal) {
+        const OpPrecedence precedence = operand.precedence();
+        if (precedence < Derived::op_precedence || (enclose_equal && precedence == Derived::op_precedence)) {
+            out << '(';
+            operand.print(out);
+            out << ')';
+        } else {
+            operand.print(out);
+        }
+    };
+
+    print_operand(*this->lhs, pow);
+    out << ' ' << Derived::symbol << ' ';
+    print_operand(*this->rhs, true);
+}
 
-    if (((expr = std::dynamic_pointer_cast<BinOp<T>>(this->rhs))) &&
-        (expr->precedence() < this->precedence())) {
-        rhs_str = std::format("({})", rhs_str);
-    }
+template<typename T, typename Derived>
+std::size_t BinOpImpl<T, Derived>::hash() const {
+    std::size_t seed = static_cast<std::size_t>(Derived::op_code);
+    seed = hash_combine(seed, std::hash<const BaseExpr<T>*>{}(this->lhs.get()));
+    return hash_combine(seed, std::hash<const BaseExpr<T>*>{}(this->rhs.get()));
+}
+
+template<typename T, typename Derived>
+bool BinOpImpl<T, Derived>::equals(const BaseExpr<T>& other) const {
+    const auto* expr = dynamic_cast<const Derived*>(&other);
+    return expr != nullptr && expr->lhs == this->lhs && expr->rhs == this->rhs;
+}
+
+template<typename T, typename Derived>
+std::uint32_t BinOpImpl<T, Derived>::compile(TapeBuilder<T>& builder) const {
+    const std::uint32_t lhs_reg = builder.lower(this->lhs);
+    const std::uint32_t rhs_reg = builder.lower(this->rhs);
+    return builder.emit(Derived::op_code, lhs_reg, rhs_reg);
+}
+
+template<typename T, typename Derived>
+std::shared_ptr<BaseExpr<T>> BinOpImpl<T, Derived>::simplify(Simplifier<T>& simplifier) const {
+    return Derived::simplified(simplifier.simplify(this->lhs), simplifier.simplify(this->rhs));
+}
 
-    return std::format("{} {} {}", lhs_str, this->name(), rhs_str);
+template<typename T, typename Derived>
+std::shared_ptr<BaseExpr<T>> BinOpImpl<T, Derived>::fold(
+    const std::shared_ptr<BaseExpr<T>>& lhs,
+    const std::shared_ptr<BaseExpr<T>>& rhs
+) {
+    if (!Simplifier<T>::constant_value(lhs) || !Simplifier<T>::constant_value(rhs)) {
+        return nullptr;
+    }
+    return Simplifier<T>::make_constant(Derived(lhs, rhs).resolve());
 }
 
 template class BinOp<RealNumber>;
+template class BinOp<double>;
+template class BinOp<float>;
 template class BinOp<ComplexNumber>;
 
 template class BinOpImpl<RealNumber, AddOp<RealNumber>>;
+template class BinOpImpl<double, AddOp<double>>;
+template class BinOpImpl<float, AddOp<float>>;
 template class BinOpImpl<ComplexNumber, AddOp<ComplexNumber>>;
 
 template class BinOpImpl<RealNumber, SubOp<RealNumber>>;
+template class BinOpImpl<double, SubOp<double>>;
+template class BinOpImpl<float, SubOp<float>>;
 template class BinOpImpl<ComplexNumber, SubOp<ComplexNumber>>;
 
 template class BinOpImpl<RealNumber, MulOp<RealNumber>>;
+template class BinOpImpl<double, MulOp<double>>;
+template class BinOpImpl<float, MulOp<float>>;
 template class BinOpImpl<ComplexNumber, MulOp<ComplexNumber>>;
 
 template class BinOpImpl<RealNumber, DivOp<RealNumber>>;
+template class BinOpImpl<double, DivOp<double>>;
+template class BinOpImpl<float, DivOp<float>>;
 template class BinOpImpl<ComplexNumber, DivOp<ComplexNumber>>;
 
 template class BinOpImpl<RealNumber, PowOp<RealNumber>>;
+template class BinOpImpl<double, PowOp<double>>;
+template class BinOpImpl<float, PowOp<float>>;
 template class BinOpImpl<ComplexNumber, PowOp<ComplexNumber>>;
@@ -6,24 +6,63 @@ T DivOp<T>::resolve() const {
 }
 
 template<typename T>
-std::shared_ptr<BaseExpr<T>> DivOp<T>::diff(const std::string& by) const {
-    return std::make_shared<DivOp<T>>(
-        std::make_shared<AddOp<T>>(
-            std::make_shared<MulOp<T>>(
-                this->lhs->diff(by),
-                this->rhs
-            ),
-            std::make_shared<MulOp<T>>(
-                this->lhs,
-                this->rhs->diff(by)
-            )
-        ),
-        std::make_shared<PowOp<T>>(
+std::shared_ptr<BaseExpr<T>> DivOp<T>::diff(const std::string& by, DiffCache<T>& cache) const {
+    auto lhs_derivative = cache.diff(this->lhs, by);
+    auto rhs_derivative = cache.diff(this->rhs, by);
+    auto lhs_term = lhs_derivative == cache.zero()
+        ? lhs_derivative
+        : make_node<MulOp<T>>(lhs_derivative, this->rhs);
+    // A constant divisor leaves only the first term of the quotient rule
+    auto numerator = rhs_derivative == cache.zero()
+        ? lhs_term
+        : make_node<SubOp<T>>(lhs_term, make_node<MulOp<T>>(this->lhs, rhs_derivative));
+    return make_node<DivOp<T>>(
+        numerator,
+        make_node<PowOp<T>>(
             this->rhs,
-            std::make_shared<Constant<T>>(2)
+            make_node<Constant<T>>(2)
         )
     );
 }
 
+template<typename T>
+std::shared_ptr<BaseExpr<T>> DivOp<T>::simplified(
+    const std::shared_ptr<BaseExpr<T>>& lhs,
+    const std::shared_ptr<BaseExpr<T>>& rhs
+) {
+    if (auto folded = DivOp::fold(lhs, rhs)) {
+        return folded;
+    }
+    if (Simplifier<T>::is_constant(rhs, T(1))) {
+        return lhs;
+    }
+    if (Simplifier<T>::is_constant(lhs, T(0))) {
+        return lhs;
+    }
+    if (lhs == rhs) {
+        return make_node<Constant<T>>(1);
+    }
+
+    // (a * x) / b = (a / b) * x
+    if (const auto divisor = Simplifier<T>::constant_value(rhs); divisor && divisor.value() != T(0)) {
+        const auto [coefficient, term] = Simplifier<T>::split_coefficient(lhs);
+        if (coefficient != T(1)) {
+            if (auto scaled = Simplifier<T>::scale(coefficient / divisor.value(), term)) {
+                return scaled;
+            }
+        }
+    }
+
+    // x ^ n / x ^ m = x ^ (n - m)
+    const auto [lhs_base, lhs_exponent] = Simplifier<T>::split_power(lhs);
+    const auto [rhs_base, rhs_exponent] = Simplifier<T>::split_power(rhs);
+    if (lhs_base == rhs_base) {
+        return PowOp<T>::simplified(lhs_base, SubOp<T>::simplified(lhs_exponent, rhs_exponent));
+    }
+    return make_node<DivOp>(lhs, rhs);
+}
+
 template class DivOp<RealNumber>;
+template class DivOp<double>;
+template class DivOp<float>;
 template class DivOp<ComplexNumber>;
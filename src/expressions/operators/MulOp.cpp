@@ -6,18 +6,64 @@ T MulOp<T>::resolve() const {
 }
 
 template<typename T>
-std::shared_ptr<BaseExpr<T>> MulOp<T>::diff(const std::string& by) const {
-    return std::make_shared<AddOp<T>>(
-        std::make_shared<MulOp<T>>(
-            this->lhs->diff(by),
-            this->rhs
-        ),
-        std::make_shared<MulOp<T>>(
-            this->lhs,
-            this->rhs->diff(by)
-        )
+std::shared_ptr<BaseExpr<T>> MulOp<T>::diff(const std::string& by, DiffCache<T>& cache) const {
+    auto lhs_derivative = cache.diff(this->lhs, by);
+    auto rhs_derivative = cache.diff(this->rhs, by);
+    // A factor that does not depend on `by` drops its term of the product rule
+    if (lhs_derivative == cache.zero()) {
+        return make_node<MulOp<T>>(this->lhs, rhs_derivative);
+    }
+    if (rhs_derivative == cache.zero()) {
+        return make_node<MulOp<T>>(lhs_derivative, this->rhs);
+    }
+    return make_node<AddOp<T>>(
+        make_node<MulOp<T>>(lhs_derivative, this->rhs),
+        make_node<MulOp<T>>(this->lhs, rhs_derivative)
     );
 }
 
+template<typename T>
+std::shared_ptr<BaseExpr<T>> MulOp<T>::simplified(
+    const std::shared_ptr<BaseExpr<T>>& lhs,
+    const std::shared_ptr<BaseExpr<T>>& rhs
+) {
+    if (auto folded = MulOp::fold(lhs, rhs)) {
+        return folded;
+    }
+
+    // (a * x) * (b * y) = (a * b) * (x * y), x ^ n * x ^ m = x ^ (n + m)
+    const auto [lhs_coefficient, lhs_term] = Simplifier<T>::split_coefficient(lhs);
+    const auto [rhs_coefficient, rhs_term] = Simplifier<T>::split_coefficient(rhs);
+    const T coefficient = lhs_coefficient * rhs_coefficient;
+    if (coefficient == T(0)) {
+        return make_node<Constant<T>>(0);
+    }
+
+    std::shared_ptr<BaseExpr<T>> term;
+    if (!lhs_term) {
+        term = rhs_term;
+    } else if (!rhs_term) {
+        term = lhs_term;
+    } else {
+        const auto [lhs_base, lhs_exponent] = Simplifier<T>::split_power(lhs_term);
+        const auto [rhs_base, rhs_exponent] = Simplifier<T>::split_power(rhs_term);
+        if (lhs_base == rhs_base) {
+            term = PowOp<T>::simplified(lhs_base, AddOp<T>::simplified(lhs_exponent, rhs_exponent));
+        } else if (lhs_coefficient == T(1) || rhs_coefficient == T(1)) {
+            // Nothing to collect, keep the product as written
+            return make_node<MulOp>(lhs, rhs);
+        } else {
+            term = make_node<MulOp>(lhs_term, rhs_term);
+        }
+    }
+
+    if (auto scaled = Simplifier<T>::scale(coefficient, term)) {
+        return scaled;
+    }
+    return make_node<MulOp>(lhs, rhs);
+}
+
 template class MulOp<RealNumber>;
+template class MulOp<double>;
+template class MulOp<float>;
 template class MulOp<ComplexNumber>;
@@ -6,27 +6,51 @@ T PowOp<T>::resolve() const {
 }
 
 template<typename T>
-std::shared_ptr<BaseExpr<T>> PowOp<T>::diff(const std::string& by) const {
-    return std::make_shared<MulOp<T>>(
-        std::make_shared<PowOp<T>>(
+std::shared_ptr<BaseExpr<T>> PowOp<T>::diff(const std::string& by, DiffCache<T>& cache) const {
+    auto lhs_derivative = cache.diff(this->lhs, by);
+    auto rhs_derivative = cache.diff(this->rhs, by);
+    // A constant exponent needs no logarithm and a constant base no power rule
+    std::shared_ptr<BaseExpr<T>> factor;
+    if (rhs_derivative == cache.zero()) {
+        factor = make_node<DivOp<T>>(make_node<MulOp<T>>(lhs_derivative, this->rhs), this->lhs);
+    } else if (lhs_derivative == cache.zero()) {
+        factor = make_node<MulOp<T>>(make_node<LnFunc<T>>(this->lhs), rhs_derivative);
+    } else {
+        factor = make_node<AddOp<T>>(
+            make_node<DivOp<T>>(make_node<MulOp<T>>(lhs_derivative, this->rhs), this->lhs),
+            make_node<MulOp<T>>(make_node<LnFunc<T>>(this->lhs), rhs_derivative)
+        );
+    }
+    return make_node<MulOp<T>>(
+        make_node<PowOp<T>>(
             this->lhs,
             this->rhs
         ),
-        std::make_shared<AddOp<T>>(
-            std::make_shared<DivOp<T>>(
-                std::make_shared<MulOp<T>>(
-                    this->lhs->diff(by),
-                    this->rhs
-                ),
-                this->lhs
-            ),
-            std::make_shared<MulOp<T>>(
-                std::make_shared<LnFunc<T>>(this->lhs),
-                this->rhs->diff(by)
-            )
-        )
+        factor
     );
 }
 
+template<typename T>
+std::shared_ptr<BaseExpr<T>> PowOp<T>::simplified(
+    const std::shared_ptr<BaseExpr<T>>& lhs,
+    const std::shared_ptr<BaseExpr<T>>& rhs
+) {
+    if (auto folded = PowOp::fold(lhs, rhs)) {
+        return folded;
+    }
+    if (Simplifier<T>::is_constant(rhs, T(0)) || Simplifier<T>::is_constant(lhs, T(1))) {
+        return make_node<Constant<T>>(1);
+    }
+    if (Simplifier<T>::is_constant(rhs, T(1))) {
+        return lhs;
+    }
+    if (Simplifier<T>::is_constant(rhs, T(-1))) {
+        return make_node<DivOp<T>>(make_node<Constant<T>>(1), lhs);
+    }
+    return make_node<PowOp>(lhs, rhs);
+}
+
 template class PowOp<RealNumber>;
+template class PowOp<double>;
+template class PowOp<float>;
 template class PowOp<ComplexNumber>;
@@ -6,12 +6,42 @@ T SubOp<T>::resolve() const {
 }
 
 template<typename T>
-std::shared_ptr<BaseExpr<T>> SubOp<T>::diff(const std::string& by) const {
-    return std::make_shared<SubOp<T>>(
-        this->lhs->diff(by),
-        this->rhs->diff(by)
-    );
+std::shared_ptr<BaseExpr<T>> SubOp<T>::diff(const std::string& by, DiffCache<T>& cache) const {
+    auto lhs_derivative = cache.diff(this->lhs, by);
+    auto rhs_derivative = cache.diff(this->rhs, by);
+    if (rhs_derivative == cache.zero()) {
+        return lhs_derivative;
+    }
+    return make_node<SubOp<T>>(lhs_derivative, rhs_derivative);
+}
+
+template<typename T>
+std::shared_ptr<BaseExpr<T>> SubOp<T>::simplified(
+    const std::shared_ptr<BaseExpr<T>>& lhs,
+    const std::shared_ptr<BaseExpr<T>>& rhs
+) {
+    if (auto folded = SubOp::fold(lhs, rhs)) {
+        return folded;
+    }
+    if (Simplifier<T>::is_constant(rhs, T(0))) {
+        return lhs;
+    }
+    if (Simplifier<T>::is_constant(lhs, T(0))) {
+        return MulOp<T>::simplified(make_node<Constant<T>>(-1), rhs);
+    }
+
+    // a * x - b * x = (a - b) * x
+    const auto [lhs_coefficient, lhs_term] = Simplifier<T>::split_coefficient(lhs);
+    const auto [rhs_coefficient, rhs_term] = Simplifier<T>::split_coefficient(rhs);
+    if (lhs_term && lhs_term == rhs_term) {
+        if (auto collected = Simplifier<T>::scale(lhs_coefficient - rhs_coefficient, lhs_term)) {
+            return collected;
+        }
+    }
+    return make_node<SubOp>(lhs, rhs);
 }
 
 template class SubOp<RealNumber>;
+template class SubOp<double>;
+template class SubOp<float>;
 template class SubOp<ComplexNumber>;
@@ -0,0 +1,196 @@
+#include "DiskCache.hpp"
+#include "Hash.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+// An entry file holds the key length as 8 little-endian bytes, the key and then the value.
+// The key is kept to tell hash collisions from hits.
+
+namespace {
+
+constexpr const char* ENTRY_EXTENSION = ".entry";
+constexpr const char* STATS_FILE = "stats";
+constexpr const char* LOCK_FILE = "lock";
+
+// Exclusive `flock` on the cache's lock file for the lifetime of the object
+class FileLock {
+public:
+    explicit FileLock(const std::filesystem::path& path) {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0 || ::flock(fd, LOCK_EX) != 0) {
+            const int error = errno;
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            throw std::runtime_error(std::format("Can not lock \"{}\": {}", path.string(), std::strerror(error)));
+        }
+    }
+
+    ~FileLock() {
+        ::flock(fd, LOCK_UN);
+        ::close(fd);
+    }
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+private:
+    int fd;
+};
+
+// Unique among the processes and threads sharing a directory
+std::filesystem::path temp_path(const std::filesystem::path& path) {
+    const std::size_t thread = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    return path.string() + "." + std::to_string(::getpid()) + "." + std::to_string(thread) + ".tmp";
+}
+
+void write_atomically(const std::filesystem::path& path, const std::string& content) {
+    const std::filesystem::path temp = temp_path(path);
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out.write(content.data(), static_cast<std::streamsize>(content.size()));
+        if (!out.flush()) {
+            throw std::runtime_error(std::format("Can not write \"{}\"", temp.string()));
+        }
+    }
+    std::filesystem::rename(temp, path);
+}
+
+}  // namespace
+
+DiskCache::DiskCache(std::filesystem::path _directory, const std::uint64_t _max_bytes)
+    : directory(std::move(_directory)), max_bytes(_max_bytes) {
+    std::filesystem::create_directories(directory);
+}
+
+DiskCache::~DiskCache() {
+    try {
+        flush();
+    } catch (...) {
+        // Losing counters must not turn a finished run into a failure
+    }
+}
+
+std::filesystem::path DiskCache::entry_path(const std::string_view key) const {
+    return directory / (hex_digest(fnv1a_hash(key)) + ENTRY_EXTENSION);
+}
+
+std::optional<std::string> DiskCache::lookup(const std::string_view key) {
+    const std::filesystem::path path = entry_path(key);
+    std::ifstream in(path, std::ios::binary);
+    std::array<unsigned char, 8> size_bytes;
+    if (in && in.read(reinterpret_cast<char*>(size_bytes.data()), size_bytes.size())) {
+        std::uint64_t key_size = 0;
+        for (std::size_t i = 0; i < size_bytes.size(); ++i) {
+            key_size |= static_cast<std::uint64_t>(size_bytes[i]) << (8 * i);
+        }
+        if (key_size == key.size()) {
+            std::string stored_key(key.size(), '\0');
+            in.read(stored_key.data(), static_cast<std::streamsize>(stored_key.size()));
+            if (in && stored_key == key) {
+                std::ostringstream value;
+                value << in.rdbuf();
+                // Recently used entries are evicted last
+                std::error_code ignored;
+                std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ignored);
+                ++pending_hits;
+                return std::move(value).str();
+            }
+        }
+    }
+    ++pending_misses;
+    return std::nullopt;
+}
+
+void DiskCache::store(const std::string_view key, const std::string_view value) {
+    std::string content(8, '\0');
+    for (std::size_t i = 0; i < 8; ++i) {
+        content[i] = static_cast<char>(static_cast<std::uint64_t>(key.size()) >> (8 * i));
+    }
+    content.append(key);
+    content.append(value);
+    write_atomically(entry_path(key), content);
+    update(content.size());
+}
+
+void DiskCache::flush() {
+    update(0);
+}
+
+DiskCacheStats DiskCache::stats() {
+    return update(0);
+}
+
+DiskCacheStats DiskCache::update(const std::uint64_t added_bytes) {
+    std::lock_guard guard(mutex);
+    const FileLock lock(directory / LOCK_FILE);
+
+    DiskCacheStats stats{0, 0, 0};
+    {
+        std::ifstream in(directory / STATS_FILE);
+        in >> stats.hits >> stats.misses >> stats.bytes;
+    }
+    stats.hits += pending_hits.exchange(0);
+    stats.misses += pending_misses.exchange(0);
+    // Entries overwritten by racing stores are counted twice until eviction rescans the directory
+    stats.bytes += added_bytes;
+    if (stats.bytes > max_bytes) {
+        stats.bytes = evict();
+    }
+    write_atomically(
+        directory / STATS_FILE,
+        std::to_string(stats.hits) + " " + std::to_string(stats.misses) + " " + std::to_string(stats.bytes) + "\n"
+    );
+    return stats;
+}
+
+std::uint64_t DiskCache::evict() const {
+    struct Entry {
+        std::filesystem::file_time_type used;
+        std::uint64_t size;
+        std::filesystem::path path;
+    };
+    std::vector<Entry> entries;
+    std::uint64_t total = 0;
+    for (const auto& file : std::filesystem::directory_iterator(directory)) {
+        std::error_code error;
+        if (file.path().extension() != ENTRY_EXTENSION) {
+            continue;
+        }
+        const auto used = file.last_write_time(error);
+        const auto size = file.file_size(error);
+        if (error) {
+            continue;  // Removed by another process
+        }
+        entries.push_back({used, size, file.path()});
+        total += size;
+    }
+
+    // Evict down to three quarters of the limit, so that every store does not rescan the directory
+    std::sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) {
+        return lhs.used < rhs.used;
+    });
+    const std::uint64_t target = max_bytes / 4 * 3;
+    for (const Entry& entry : entries) {
+        if (total <= target) {
+            break;
+        }
+        std::error_code ignored;
+        std::filesystem::remove(entry.path, ignored);
+        total -= entry.size;
+    }
+    return total;
+}
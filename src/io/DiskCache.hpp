@@ -0,0 +1,53 @@
+#ifndef DISK_CACHE_HPP
+#define DISK_CACHE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+struct DiskCacheStats {
+    std::uint64_t hits;
+    std::uint64_t misses;
+    std::uint64_t bytes;
+};
+
+/// Key-value store in a directory, shared by any number of processes. Every entry is a file
+/// named by the hash of its key, published with an atomic rename, so readers never see a
+/// partial entry. Counters and eviction state are kept in a stats file updated under `flock`.
+/// When the entries outgrow `max_bytes`, the least recently used ones are removed.
+class DiskCache {
+public:
+    DiskCache(std::filesystem::path directory, std::uint64_t max_bytes);
+    /// Flushes the counters.
+    ~DiskCache();
+
+    DiskCache(const DiskCache&) = delete;
+    DiskCache& operator=(const DiskCache&) = delete;
+
+    std::optional<std::string> lookup(std::string_view key);
+    void store(std::string_view key, std::string_view value);
+
+    /// Writes the hit and miss counts of this process to the stats file.
+    void flush();
+    /// Counters of all processes sharing the directory.
+    DiskCacheStats stats();
+
+private:
+    std::filesystem::path directory;
+    std::uint64_t max_bytes;
+
+    std::atomic<std::uint64_t> pending_hits = 0;
+    std::atomic<std::uint64_t> pending_misses = 0;
+    std::mutex mutex;
+
+    std::filesystem::path entry_path(std::string_view key) const;
+    // Adds the pending counters and `added_bytes` to the stats file and evicts if needed
+    DiskCacheStats update(std::uint64_t added_bytes);
+    std::uint64_t evict() const;
+};
+
+#endif  // DISK_CACHE_HPP
@@ -0,0 +1,27 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// 64-bit FNV-1a: stable across runs and platforms, which the on-disk caches rely on.
+inline std::uint64_t fnv1a_hash(const std::string_view data) {
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char c : data) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/// The hash as 16 lowercase hex digits, for file names.
+inline std::string hex_digest(std::uint64_t hash) {
+    std::string digits(16, '0');
+    for (std::size_t i = digits.size(); i-- > 0; hash >>= 4) {
+        digits[i] = "0123456789abcdef"[hash & 0xf];
+    }
+    return digits;
+}
+
+#endif  // HASH_HPP
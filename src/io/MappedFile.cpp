@@ -0,0 +1,71 @@
+#include "MappedFile.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error(std::format("Can not open \"{}\": {}", path.string(), std::strerror(errno)));
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::runtime_error(std::format("Can not read \"{}\": {}", path.string(), std::strerror(error)));
+    }
+    size = static_cast<std::size_t>(info.st_size);
+    // Empty files can not be mapped, and need not be
+    if (size != 0) {
+        void* address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            const int error = errno;
+            ::close(fd);
+            throw std::runtime_error(std::format("Can not map \"{}\": {}", path.string(), std::strerror(error)));
+        }
+        // Every reader walks the file front to back once
+        ::madvise(address, size, MADV_SEQUENTIAL);
+        data = static_cast<const std::byte*>(address);
+    }
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        data = std::exchange(other.data, nullptr);
+        size = std::exchange(other.size, 0);
+    }
+    return *this;
+}
+
+std::span<const std::byte> MappedFile::bytes() const {
+    return {data, size};
+}
+
+std::string_view MappedFile::text() const {
+    return {reinterpret_cast<const char*>(data), size};
+}
+
+void MappedFile::unmap() {
+    if (data != nullptr) {
+        ::munmap(const_cast<std::byte*>(data), size);
+        data = nullptr;
+    }
+    size = 0;
+}
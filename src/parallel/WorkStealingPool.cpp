@@ -0,0 +1,135 @@
+#include "WorkStealingPool.hpp"
+
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(const std::size_t threads)
+    : worker_count(std::max<std::size_t>(threads != 0 ? threads : std::thread::hardware_concurrency(), 1)) {
+    slices = std::make_unique<Slice[]>(worker_count);
+    // Worker 0 is whichever thread calls `parallel_for`
+    for (std::size_t worker = 1; worker < worker_count; ++worker) {
+        this->threads.emplace_back(&WorkStealingPool::thread_main, this, worker);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+std::size_t WorkStealingPool::size() const {
+    return worker_count;
+}
+
+WorkStealingPool& WorkStealingPool::shared() {
+    static WorkStealingPool pool;
+    return pool;
+}
+
+void WorkStealingPool::parallel_for(
+    const std::size_t count,
+    const std::function<void(std::size_t worker, std::size_t index)>& body
+) {
+    if (count == 0) {
+        return;
+    }
+    std::lock_guard call_lock(call_mutex);
+    {
+        std::lock_guard lock(mutex);
+        for (std::size_t worker = 0; worker < worker_count; ++worker) {
+            std::lock_guard slice_lock(slices[worker].mutex);
+            slices[worker].begin = count * worker / worker_count;
+            slices[worker].end = count * (worker + 1) / worker_count;
+        }
+        job = &body;
+        cancelled.store(false, std::memory_order_relaxed);
+        error = nullptr;
+        running = worker_count - 1;
+        ++generation;
+    }
+    wake.notify_all();
+
+    work(0);
+
+    std::unique_lock lock(mutex);
+    finished.wait(lock, [this] { return running == 0; });
+    job = nullptr;
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void WorkStealingPool::thread_main(const std::size_t worker) {
+    std::size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+        work(worker);
+        {
+            std::lock_guard lock(mutex);
+            --running;
+        }
+        finished.notify_one();
+    }
+}
+
+void WorkStealingPool::work(const std::size_t worker) {
+    std::size_t index;
+    while (take(worker, index) || (steal(worker) && take(worker, index))) {
+        try {
+            (*job)(worker, index);
+        } catch (...) {
+            std::lock_guard lock(mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            cancelled.store(true, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool WorkStealingPool::take(const std::size_t worker, std::size_t& index) {
+    Slice& slice = slices[worker];
+    std::lock_guard lock(slice.mutex);
+    if (slice.begin == slice.end || cancelled.load(std::memory_order_relaxed)) {
+        slice.begin = slice.end;
+        return false;
+    }
+    index = slice.begin++;
+    return true;
+}
+
+bool WorkStealingPool::steal(const std::size_t worker) {
+    // No new indices appear while a job runs, so one empty sweep over the victims means done
+    for (std::size_t offset = 1; offset < worker_count; ++offset) {
+        Slice& victim = slices[(worker + offset) % worker_count];
+        std::size_t begin;
+        std::size_t end;
+        {
+            std::lock_guard lock(victim.mutex);
+            if (victim.begin == victim.end) {
+                continue;
+            }
+            end = victim.end;
+            begin = victim.begin + (victim.end - victim.begin) / 2;
+            victim.end = begin;
+        }
+        Slice& own = slices[worker];
+        std::lock_guard lock(own.mutex);
+        own.begin = begin;
+        own.end = end;
+        return true;
+    }
+    return false;
+}
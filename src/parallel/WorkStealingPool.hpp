@@ -0,0 +1,66 @@
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Fixed set of worker threads running index ranges. Every worker starts with a contiguous
+/// slice of the indices and takes them from the front; a worker that runs dry steals the back
+/// half of another worker's slice, so neighbouring indices mostly stay on one thread.
+class WorkStealingPool {
+public:
+    /// 0 threads means one per hardware thread. The calling thread is one of the workers.
+    explicit WorkStealingPool(std::size_t threads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    std::size_t size() const;
+
+    /// Runs `body(worker, index)` for every index in [0, count) and waits for all of them.
+    /// `worker` is below `size()` and unique among concurrently running calls. The first exception
+    /// thrown by `body` stops the remaining indices and is rethrown. Calls from several threads are
+    /// serialized: each one waits until the pool is free. Calls must not be nested.
+    void parallel_for(std::size_t count, const std::function<void(std::size_t worker, std::size_t index)>& body);
+
+    /// Pool shared by callers that do not manage their own.
+    static WorkStealingPool& shared();
+
+private:
+    struct alignas(64) Slice {
+        std::mutex mutex;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+    };
+
+    std::vector<std::thread> threads;
+    std::unique_ptr<Slice[]> slices;
+    std::size_t worker_count;
+
+    // Held for the whole of a `parallel_for`, since the pool runs one job at a time
+    std::mutex call_mutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(std::size_t, std::size_t)>* job = nullptr;
+    std::size_t generation = 0;
+    std::size_t running = 0;
+    bool stopping = false;
+    std::atomic<bool> cancelled = false;
+    std::exception_ptr error;
+
+    void thread_main(std::size_t worker);
+    void work(std::size_t worker);
+    bool take(std::size_t worker, std::size_t& index);
+    bool steal(std::size_t worker);
+};
+
+#endif  // WORK_STEALING_POOL_HPP
@@ -1,80 +1,143 @@
 #include "Lexer.hpp"
 
-#include <vector>
+#include <array>
 #include <utility>
-#include <ranges>
 #include <algorithm>
+#include <format>
 #include <stdexcept>
 #include <type_traits>
 
 #include "../expressions/expressions.hpp"
 
+namespace {
+
+constexpr bool is_digit(const char chr) {
+    return chr >= '0' && chr <= '9';
+}
+
+constexpr bool is_word_char(const char chr) {
+    return (chr >= 'a' && chr <= 'z') || (chr >= 'A' && chr <= 'Z') || chr == '_';
+}
+
+constexpr bool is_space(const char chr) {
+    return chr == ' ' || chr == '\t' || chr == '\n' || chr == '\v' || chr == '\f' || chr == '\r';
+}
+
+constexpr char to_lower(const char chr) {
+    return chr >= 'A' && chr <= 'Z' ? static_cast<char>(chr - 'A' + 'a') : chr;
+}
+
+bool equals_ignore_case(const std::string_view lhs, const std::string_view rhs) {
+    return std::ranges::equal(lhs, rhs, [](const char a, const char b) { return to_lower(a) == to_lower(b); });
+}
+
+bool is_function_name(const std::string_view word) {
+    for (const std::string_view name : {"sin", "cos", "ln", "exp"}) {
+        if (equals_ignore_case(word, name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
 template<typename T>
-Lexer<T>::Lexer(const std::string& input, const bool case_sensitive) {
-    str = input;
+Lexer<T>::Lexer(const std::string_view input, const bool case_sensitive)
+    : str(input), case_sensitive(case_sensitive) {}
+
+template<typename T>
+std::string Lexer<T>::normalized(const std::string_view text) const {
+    std::string result(text);
     if (!case_sensitive) {
-        std::ranges::transform(str, str.begin(), tolower);
+        std::ranges::transform(result, result.begin(), to_lower);
     }
-    it = str.begin();
+    return result;
+}
+
+template<typename T>
+char Lexer<T>::peek(const std::size_t offset) const {
+    return pos + offset < str.size() ? str[pos + offset] : '\0';
 }
 
 template<typename T>
-char Lexer<T>::peek() const {
-    return *it;
+void Lexer<T>::advance(const std::size_t count) {
+    pos += count;
 }
 
+/// number
+///   ::= ('0' | [1-9][0-9]*) ('.' [0-9]+)?
 template<typename T>
-void Lexer<T>::advance() {
-    ++it;
+std::string_view Lexer<T>::scan_number() {
+    const std::size_t start = pos;
+    if (peek() == '0') {
+        advance();
+    } else {
+        while (is_digit(peek())) {
+            advance();
+        }
+    }
+    if (peek() == '.' && is_digit(peek(1))) {
+        advance();
+        while (is_digit(peek())) {
+            advance();
+        }
+    }
+    return str.substr(start, pos - start);
 }
 
+/// word
+///   ::= [a-zA-Z_]+
 template<typename T>
-std::optional<std::string> Lexer<T>::get_str_by_pattern(const std::regex& regexp) {
-    std::smatch match_result;
-    const bool match_status = std::regex_search(
-        it, str.cend(), match_result, regexp, std::regex_constants::match_continuous
-    );
-    if (!match_status) {
-        return std::nullopt;
+std::string_view Lexer<T>::scan_word() {
+    const std::size_t start = pos;
+    while (is_word_char(peek())) {
+        advance();
     }
-    it = match_result[0].second;
-    return std::string(match_result[0].first, match_result[0].second);
+    return str.substr(start, pos - start);
 }
 
 template<typename T>
 Token Lexer<T>::get_token_from_str() {
-    while (std::isspace(peek())) {
+    while (is_space(peek())) {
         advance();
     }
     if (peek() == '\0') {
         return Token(EOL, "EOL");
     }
 
-    for (TokenType token_type : {
-        RNumber,
-        Function,
-        Identifier
-    }) {
-        const auto str = get_str_by_pattern(REGEX_PATTERN_MAP.at(token_type));
-        if (str.has_value()) {
-            if constexpr (std::is_same_v<T, std::complex<long double>>) {
-                if (token_type == Identifier && str.value() == "i") {
-                    return Token(ImaginaryUnit);
-                }
+    if (is_digit(peek())) {
+        return Token(RNumber, scan_number());
+    }
+
+    if (is_word_char(peek())) {
+        const std::size_t start = pos;
+        const std::string_view word = scan_word();
+        if (peek() == '(' && is_function_name(word)) {
+            advance();
+            return Token(Function, str.substr(start, pos - start));
+        }
+        if constexpr (std::is_same_v<T, std::complex<long double>>) {
+            if (word == "i" || (!case_sensitive && word == "I")) {
+                return Token(ImaginaryUnit, "");
             }
-            return Token(token_type, str.value());
         }
+        return Token(Identifier, word);
     }
 
     const char chr = peek();
     advance();
     switch (chr) {
     case '+':
+        return Token(BinOperator, "+");
     case '-':
+        return Token(BinOperator, "-");
     case '*':
+        return Token(BinOperator, "*");
     case '/':
+        return Token(BinOperator, "/");
     case '^':
-        return Token(BinOperator, std::string(1, chr));
+        return Token(BinOperator, "^");
     case '(':
         return Token(OpeningParen, "(");
     case ')':
@@ -98,7 +161,7 @@ Token Lexer<T>::next_token() {
     }
 
     // Adding implicit multiplication
-    static const std::vector<std::pair<TokenType, TokenType>> pairs = {
+    static constexpr std::array<std::pair<TokenType, TokenType>, 11> pairs = {{
         {RNumber,       Identifier},
         {RNumber,       Function},
         {RNumber,       OpeningParen},
@@ -110,7 +173,7 @@ Token Lexer<T>::next_token() {
         {ClosingParen,  ImaginaryUnit},
         {ClosingParen,  Identifier},
         {ClosingParen,  Function}
-    };
+    }};
     if (std::ranges::find(pairs, std::pair{prev_token_type, token.type}) != pairs.end()) {
         discarded_token = token;
         prev_token_type = token.type;
@@ -121,4 +184,6 @@ Token Lexer<T>::next_token() {
 }
 
 template class Lexer<RealNumber>;
+template class Lexer<double>;
+template class Lexer<float>;
 template class Lexer<ComplexNumber>;
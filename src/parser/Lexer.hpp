@@ -2,10 +2,10 @@
 #define LEXER_HPP
 
 #include <complex>
-#include <string>
-#include <regex>
+#include <cstddef>
 #include <optional>
-#include <unordered_map>
+#include <string>
+#include <string_view>
 
 enum TokenType {
     RNumber,
@@ -18,7 +18,7 @@ enum TokenType {
     EOL
 };
 
-const std::string TokenTypeNames[] = {  // FIXME: for test only
+constexpr std::string_view TokenTypeNames[] = {  // FIXME: for test only
     "RNumber",
     "ImaginaryUnit",
     "Variable",
@@ -29,35 +29,36 @@ const std::string TokenTypeNames[] = {  // FIXME: for test only
     "End"
 };
 
-const std::unordered_map<TokenType, std::regex> REGEX_PATTERN_MAP = {
-    {RNumber, std::regex("(0|[1-9][0-9]*)(\\.[0-9]+)?")},
-    {Identifier, std::regex("[a-zA-Z_]+")},
-    {Function, std::regex("(sin|cos|ln|exp)\\(", std::regex_constants::icase)}
-};
-
+/// `value` points into the lexer input (or a string literal), so the input must outlive the tokens.
 struct Token {
     TokenType type;
-    std::string value;
+    std::string_view value;
 };
 
 template<typename T>
 class Lexer {
 public:
-    explicit Lexer(const std::string& input, bool case_sensitive = false);
+    explicit Lexer(std::string_view input, bool case_sensitive = false);
 
     Token next_token();
 
+    /// Identifiers and function names are case-insensitive unless requested otherwise;
+    /// tokens keep the input's spelling and this returns the canonical one.
+    std::string normalized(std::string_view text) const;
+
 private:
-    std::string str;
-    std::string::const_iterator it;
+    std::string_view str;
+    std::size_t pos = 0;
+    bool case_sensitive;
     TokenType prev_token_type = EOL;
     std::optional<Token> discarded_token = std::nullopt;
 
-    char peek() const;
-    void advance();
+    char peek(std::size_t offset = 0) const;
+    void advance(std::size_t count = 1);
 
     Token get_token_from_str();
-    std::optional<std::string> get_str_by_pattern(const std::regex& regexp);
+    std::string_view scan_number();
+    std::string_view scan_word();
 };
 
 #endif  // LEXER_HPP
@@ -2,8 +2,25 @@
 #include "Lexer.hpp"
 #include "../expressions/expressions.hpp"
 
+#include <charconv>
+#include <format>
 #include <string>
 #include <stdexcept>
+#include <vector>
+
+namespace {
+
+template<typename Real>
+Real parse_number(const std::string_view text) {
+    Real value = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc() || end != text.data() + text.size()) {
+        throw std::runtime_error(std::format("Invalid number: \"{}\"", text));
+    }
+    return value;
+}
+
+}  // namespace
 
 template<typename T>
 Token Parser<T>::consume(const TokenType expect) {
@@ -18,126 +35,133 @@ Token Parser<T>::advance() {
     return cur_token = lexer.next_token();
 }
 
-template<>
-std::shared_ptr<BaseExpr<RealNumber>> Parser<RealNumber>::parse_real_number() {
-    auto res = std::make_shared<Constant<RealNumber>>(std::stold(cur_token.value));
+template<typename T>
+std::shared_ptr<BaseExpr<T>> Parser<T>::parse_real_number() {
+    auto res = make_node<Constant<T>>(parse_number<T>(cur_token.value));
     advance();
     return res;
 }
 
 template<>
 std::shared_ptr<BaseExpr<ComplexNumber>> Parser<ComplexNumber>::parse_real_number() {
-    auto real_part = ComplexNumber(std::stold(cur_token.value), 0);
-    auto res = std::make_shared<Constant<ComplexNumber>>(real_part);
+    auto real_part = ComplexNumber(parse_number<RealNumber>(cur_token.value), 0);
+    auto res = make_node<Constant<ComplexNumber>>(real_part);
     advance();
     return res;
 }
 
-template<>
-std::shared_ptr<BaseExpr<RealNumber>> Parser<RealNumber>::parse_imaginary_unit() {
-    throw std::runtime_error("Can not parse imaginary unit in Parser<RealNumber>");
+template<typename T>
+std::shared_ptr<BaseExpr<T>> Parser<T>::parse_imaginary_unit() {
+    throw std::runtime_error("Can not parse imaginary unit in a real-valued Parser");
 }
 
 template<>
 std::shared_ptr<BaseExpr<ComplexNumber>> Parser<ComplexNumber>::parse_imaginary_unit() {
     constexpr auto imaginary_unit = ComplexNumber(0, 1);
-    auto res = std::make_shared<Constant<ComplexNumber>>(imaginary_unit);
+    auto res = make_node<Constant<ComplexNumber>>(imaginary_unit);
     advance();
     return res;
 }
 
 template<typename T>
 std::shared_ptr<BaseExpr<T>> Parser<T>::parse_identifier() {
-    auto res = std::make_shared<Variable<T>>(cur_token.value);
+    auto res = make_node<Variable<T>>(lexer.normalized(cur_token.value));
     advance();
     return res;
 }
 
-/// parentheses_expr
-///   ::= '(' expression ')'
-template<typename T>
-std::shared_ptr<BaseExpr<T>> Parser<T>::parse_parentheses_expr() {
-    consume(OpeningParen);
-    auto expr = parse_expression();
-    consume(ClosingParen);
-    return expr;
-}
-
-/// function
-///   ::= <func_name>( expression ')'
-template<typename T>
-std::shared_ptr<BaseExpr<T>> Parser<T>::parse_function() {
-    const std::string func_name = cur_token.value.substr(0, cur_token.value.length() - 1);
-    consume(Function);
-    auto expr = parse_expression();
-    consume(ClosingParen);
-    return Func<T>::from_name(func_name, expr);
-}
-
-/// primary
+/// expression
+///   ::= operand (bin_operator operand)*
+/// operand
 ///   ::= identifier
 ///   ::= real_number
 ///   ::= imaginary_unit
-///   ::= parentheses_expr
-///   ::= function
-template<typename T>
-std::shared_ptr<BaseExpr<T>> Parser<T>::parse_primary() {
-    switch (cur_token.type) {
-    case OpeningParen:
-        return parse_parentheses_expr();
-    case Function:
-        return parse_function();
-    case RNumber:
-        return parse_real_number();
-    case ImaginaryUnit:
-        return parse_imaginary_unit();
-    case Identifier:
-        return parse_identifier();
-    default:
-        throw std::runtime_error(std::format("Unexpected token: \"{}\"", cur_token.value));
-    }
-}
-
-/// bin_op_rhs
-///   ::= ('+' primary)*
+///   ::= '(' expression ')'
+///   ::= <func_name>( expression ')'
+///
+/// Operator precedence parsing with explicit stacks, so neither nesting depth nor operator chains
+/// grow the call stack, and every token is handled once. All operators are left-associative;
+/// an operator first applies every pending one that binds at least as tightly.
 template<typename T>
-std::shared_ptr<BaseExpr<T>> Parser<T>::parse_bin_op_rhs(
-    const OpPrecedence expr_precedence, std::shared_ptr<BaseExpr<T>> lhs
-) {
-    while (cur_token.type != EOL && cur_token.type != ClosingParen) {
-        if (cur_token.type != BinOperator) {
-            throw std::runtime_error(std::format("Expected binary operator, got: \"{}\"", cur_token.value));
+std::shared_ptr<BaseExpr<T>> Parser<T>::parse_expression() {
+    // Pending operators, and the parentheses and function calls they are nested in
+    struct Pending {
+        enum Kind { Operator, Group, Call } kind;
+        OpPrecedence precedence;
+        std::string_view name;
+    };
+    std::vector<std::shared_ptr<BaseExpr<T>>> operands;
+    std::vector<Pending> pending;
+
+    const auto apply_operators = [&](const auto& applies) {
+        while (!pending.empty() && pending.back().kind == Pending::Operator && applies(pending.back())) {
+            auto rhs = std::move(operands.back());
+            operands.pop_back();
+            operands.back() = BinOp<T>::from_name(pending.back().name, operands.back(), rhs);
+            pending.pop_back();
         }
-        const std::string bin_op = cur_token.value;
-        const auto bin_op_precedence = BinOp<T>::get_precedence_by_name(bin_op);
-        if (bin_op_precedence < expr_precedence) {
+    };
+    const auto all = [](const Pending&) { return true; };
+
+    for (;;) {
+        // An operand, possibly after opening parentheses and functions
+        switch (cur_token.type) {
+        case OpeningParen:
+            pending.push_back({Pending::Group, OpPrecedence::Atom, {}});
+            advance();
+            continue;
+        case Function:
+            pending.push_back({Pending::Call, OpPrecedence::Atom, cur_token.value});
+            advance();
+            continue;
+        case RNumber:
+            operands.push_back(parse_real_number());
             break;
+        case ImaginaryUnit:
+            operands.push_back(parse_imaginary_unit());
+            break;
+        case Identifier:
+            operands.push_back(parse_identifier());
+            break;
+        default:
+            throw std::runtime_error(std::format("Unexpected token: \"{}\"", cur_token.value));
         }
-        advance();
-        auto rhs = parse_primary();
-        if (cur_token.type == BinOperator) {
-            const std::string next_bin_op = cur_token.value;
-            const auto next_bin_op_precedence = BinOp<T>::get_precedence_by_name(next_bin_op);
-            if (bin_op_precedence < next_bin_op_precedence) {
-                rhs = parse_bin_op_rhs(OpPrecedence(int(bin_op_precedence) + 1), rhs);
+
+        // Closing parentheses, then either an operator or the end of the input
+        while (cur_token.type == ClosingParen) {
+            apply_operators(all);
+            if (pending.empty()) {
+                throw std::runtime_error(std::format("Unexpected token: \"{}\"", cur_token.value));
+            }
+            if (pending.back().kind == Pending::Call) {
+                const std::string_view call = pending.back().name;
+                operands.back() = Func<T>::from_name(
+                    lexer.normalized(call.substr(0, call.length() - 1)), operands.back()
+                );
             }
+            pending.pop_back();
+            advance();
         }
-        lhs = BinOp<T>::from_name(bin_op, lhs, rhs);
+        if (cur_token.type == EOL) {
+            apply_operators(all);
+            if (!pending.empty()) {
+                throw std::runtime_error(std::format("Unexpected token: \"{}\"", cur_token.value));
+            }
+            return std::move(operands.back());
+        }
+        if (cur_token.type != BinOperator) {
+            throw std::runtime_error(std::format("Expected binary operator, got: \"{}\"", cur_token.value));
+        }
+        const OpPrecedence precedence = BinOp<T>::get_precedence_by_name(cur_token.value);
+        apply_operators([precedence](const Pending& top) { return top.precedence >= precedence; });
+        pending.push_back({Pending::Operator, precedence, cur_token.value});
+        advance();
     }
-    return lhs;
-}
-
-/// expression
-///   ::= primary bin_op_rhs
-template<typename T>
-std::shared_ptr<BaseExpr<T>> Parser<T>::parse_expression() {
-    auto lhs = parse_primary();
-    return parse_bin_op_rhs(OpPrecedence::AddSub, lhs);
 }
 
 template<typename T>
 Parser<T>::Parser(
-    const std::string& expression_str, const bool case_sensitive
+    const std::string_view expression_str, const bool case_sensitive
 ) : lexer(expression_str, case_sensitive) {
     cur_token = lexer.next_token();
 }
@@ -148,4 +172,6 @@ Expression<T> Parser<T>::parse() {
 }
 
 template class Parser<RealNumber>;
+template class Parser<double>;
+template class Parser<float>;
 template class Parser<ComplexNumber>;
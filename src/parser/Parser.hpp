@@ -4,10 +4,13 @@
 #include "Lexer.hpp"
 #include "../expressions/expressions.hpp"
 
+#include <memory>
+#include <string_view>
+
 template<typename T = RealNumber>
 class Parser {
 public:
-    explicit Parser(const std::string& expression_str, bool case_sensitive = false);
+    explicit Parser(std::string_view expression_str, bool case_sensitive = false);
     Expression<T> parse();
 
 private:
@@ -20,10 +23,6 @@ private:
     std::shared_ptr<BaseExpr<T>> parse_real_number();
     std::shared_ptr<BaseExpr<T>> parse_imaginary_unit();
     std::shared_ptr<BaseExpr<T>> parse_identifier();
-    std::shared_ptr<BaseExpr<T>> parse_parentheses_expr();
-    std::shared_ptr<BaseExpr<T>> parse_function();
-    std::shared_ptr<BaseExpr<T>> parse_primary();
-    std::shared_ptr<BaseExpr<T>> parse_bin_op_rhs(OpPrecedence expr_precedence, std::shared_ptr<BaseExpr<T>> lhs);
     std::shared_ptr<BaseExpr<T>> parse_expression();
 };
 
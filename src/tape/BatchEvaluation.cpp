@@ -0,0 +1,386 @@
+#include "Tape.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <functional>
+#include <stdexcept>
+
+namespace {
+
+// Rows are evaluated in blocks so that every register of the block stays in L1/L2
+constexpr std::size_t BATCH_BLOCK_SIZE = 256;
+
+struct Pow {
+    template<typename T>
+    T operator()(const T& lhs, const T& rhs) const {
+        return std::pow(lhs, rhs);
+    }
+};
+
+struct Sin {
+    template<typename T>
+    T operator()(const T& arg) const {
+        return std::sin(arg);
+    }
+};
+
+struct Cos {
+    template<typename T>
+    T operator()(const T& arg) const {
+        return std::cos(arg);
+    }
+};
+
+struct Ln {
+    template<typename T>
+    T operator()(const T& arg) const {
+        return std::log(arg);
+    }
+};
+
+struct Exp {
+    template<typename T>
+    T operator()(const T& arg) const {
+        return std::exp(arg);
+    }
+};
+
+// Arithmetic kernels are cloned for AVX-512 and AVX2; the loader picks the best clone the CPU supports
+// and falls back to the plain scalar version otherwise. Only the `double` and `float` instantiations
+// vectorize: x87 `long double` has no vector units, and neither has complex division. The loops are
+// only vectorized in optimized (`RELEASE=1`) builds.
+template<typename T, typename Op>
+[[gnu::target_clones("avx512f", "avx2", "default")]]
+void arithmetic_kernel(const T* __restrict lhs, const T* __restrict rhs, T* __restrict out, const std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i] = Op{}(lhs[i], rhs[i]);
+    }
+}
+
+// `pow` and the functions stay one libm call per row in any clone, so their kernels are not cloned
+template<typename T, typename Op>
+void binary_kernel(const T* __restrict lhs, const T* __restrict rhs, T* __restrict out, const std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i] = Op{}(lhs[i], rhs[i]);
+    }
+}
+
+template<typename T, typename Op>
+void unary_kernel(const T* __restrict arg, T* __restrict out, const std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i] = Op{}(arg[i]);
+    }
+}
+
+// Complex operations on split parts: (a + bi) op (c + di) is written to (re + im i)
+
+struct SplitAdd {
+    template<typename R>
+    void operator()(R a, R b, R c, R d, R& re, R& im) const {
+        re = a + c;
+        im = b + d;
+    }
+};
+
+struct SplitSub {
+    template<typename R>
+    void operator()(R a, R b, R c, R d, R& re, R& im) const {
+        re = a - c;
+        im = b - d;
+    }
+};
+
+struct SplitMul {
+    template<typename R>
+    void operator()(R a, R b, R c, R d, R& re, R& im) const {
+        re = a * c - b * d;
+        im = a * d + b * c;
+    }
+};
+
+// The divisor is scaled by its larger part first, so that squaring it can not overflow
+struct SplitDiv {
+    template<typename R>
+    void operator()(R a, R b, R c, R d, R& re, R& im) const {
+        const R scale = std::max(std::abs(c), std::abs(d));
+        const R sc = c / scale;
+        const R sd = d / scale;
+        const R denominator = c * sc + d * sd;
+        re = (a * sc + b * sd) / denominator;
+        im = (b * sc - a * sd) / denominator;
+    }
+};
+
+// z^w = exp(w ln z), with 0^w = 0 as in std::pow
+struct SplitPow {
+    template<typename R>
+    void operator()(R a, R b, R c, R d, R& re, R& im) const {
+        const R log_abs = std::log(std::hypot(a, b));
+        const R arg = std::atan2(b, a);
+        const R magnitude = std::exp(c * log_abs - d * arg);
+        const R phase = c * arg + d * log_abs;
+        const bool zero = a == 0 && b == 0;
+        re = zero ? 0 : magnitude * std::cos(phase);
+        im = zero ? 0 : magnitude * std::sin(phase);
+    }
+};
+
+struct SplitSin {
+    template<typename R>
+    void operator()(R a, R b, R& re, R& im) const {
+        re = std::sin(a) * std::cosh(b);
+        im = std::cos(a) * std::sinh(b);
+    }
+};
+
+struct SplitCos {
+    template<typename R>
+    void operator()(R a, R b, R& re, R& im) const {
+        re = std::cos(a) * std::cosh(b);
+        im = -std::sin(a) * std::sinh(b);
+    }
+};
+
+struct SplitLn {
+    template<typename R>
+    void operator()(R a, R b, R& re, R& im) const {
+        re = std::log(std::hypot(a, b));
+        im = std::atan2(b, a);
+    }
+};
+
+struct SplitExp {
+    template<typename R>
+    void operator()(R a, R b, R& re, R& im) const {
+        const R magnitude = std::exp(a);
+        re = magnitude * std::cos(b);
+        im = magnitude * std::sin(b);
+    }
+};
+
+// As for real tapes, only the arithmetic kernels are cloned: on `double` and `float` parts they
+// vectorize, while the others make libm calls (`hypot`, `atan2`, `exp`, `sin`...) for every row
+template<typename R, typename Op>
+[[gnu::target_clones("avx512f", "avx2", "default")]]
+void split_arithmetic_kernel(
+    const R* __restrict lhs_re, const R* __restrict lhs_im,
+    const R* __restrict rhs_re, const R* __restrict rhs_im,
+    R* __restrict out_re, R* __restrict out_im, const std::size_t n
+) {
+    for (std::size_t i = 0; i < n; ++i) {
+        Op{}(lhs_re[i], lhs_im[i], rhs_re[i], rhs_im[i], out_re[i], out_im[i]);
+    }
+}
+
+template<typename R, typename Op>
+void split_binary_kernel(
+    const R* __restrict lhs_re, const R* __restrict lhs_im,
+    const R* __restrict rhs_re, const R* __restrict rhs_im,
+    R* __restrict out_re, R* __restrict out_im, const std::size_t n
+) {
+    for (std::size_t i = 0; i < n; ++i) {
+        Op{}(lhs_re[i], lhs_im[i], rhs_re[i], rhs_im[i], out_re[i], out_im[i]);
+    }
+}
+
+template<typename R, typename Op>
+void split_unary_kernel(
+    const R* __restrict arg_re, const R* __restrict arg_im,
+    R* __restrict out_re, R* __restrict out_im, const std::size_t n
+) {
+    for (std::size_t i = 0; i < n; ++i) {
+        Op{}(arg_re[i], arg_im[i], out_re[i], out_im[i]);
+    }
+}
+
+}  // namespace
+
+template<typename T>
+void CompiledExpression<T>::evaluate_batch(std::span<const std::span<const T>> columns, std::span<T> out) {
+    if (columns.size() < variable_names.size()) {
+        throw std::invalid_argument(std::format(
+            "Expected {} variable columns, got {}", variable_names.size(), columns.size()
+        ));
+    }
+    for (std::size_t slot = 0; slot < variable_names.size(); ++slot) {
+        if (columns[slot].size() < out.size()) {
+            throw std::invalid_argument(std::format(
+                "Column for variable \"{}\" is shorter than the output", variable_names[slot]
+            ));
+        }
+    }
+
+    batch_registers.resize(code.size() * BATCH_BLOCK_SIZE);
+    batch_operands.resize(code.size());
+
+    // Constants never change between blocks, so their registers are filled once
+    for (std::size_t i = 0; i < code.size(); ++i) {
+        T* const reg = batch_registers.data() + i * BATCH_BLOCK_SIZE;
+        batch_operands[i] = reg;
+        if (code[i].op == OpCode::Const) {
+            std::fill_n(reg, BATCH_BLOCK_SIZE, constant_pool[code[i].lhs]);
+        }
+    }
+
+    const T** const operand = batch_operands.data();
+    for (std::size_t row = 0; row < out.size(); row += BATCH_BLOCK_SIZE) {
+        const std::size_t n = std::min(BATCH_BLOCK_SIZE, out.size() - row);
+        for (std::size_t i = 0; i < code.size(); ++i) {
+            const Instruction& instr = code[i];
+            T* const reg = batch_registers.data() + i * BATCH_BLOCK_SIZE;
+            switch (instr.op) {
+            case OpCode::Const:
+                break;
+            case OpCode::Var:
+                // Variables are read straight from the caller's column, without a copy
+                operand[i] = columns[instr.lhs].data() + row;
+                break;
+            case OpCode::Add:
+                arithmetic_kernel<T, std::plus<>>(operand[instr.lhs], operand[instr.rhs], reg, n);
+                break;
+            case OpCode::Sub:
+                arithmetic_kernel<T, std::minus<>>(operand[instr.lhs], operand[instr.rhs], reg, n);
+                break;
+            case OpCode::Mul:
+                arithmetic_kernel<T, std::multiplies<>>(operand[instr.lhs], operand[instr.rhs], reg, n);
+                break;
+            case OpCode::Div:
+                arithmetic_kernel<T, std::divides<>>(operand[instr.lhs], operand[instr.rhs], reg, n);
+                break;
+            case OpCode::Pow:
+                binary_kernel<T, Pow>(operand[instr.lhs], operand[instr.rhs], reg, n);
+                break;
+            case OpCode::Sin:
+                unary_kernel<T, Sin>(operand[instr.lhs], reg, n);
+                break;
+            case OpCode::Cos:
+                unary_kernel<T, Cos>(operand[instr.lhs], reg, n);
+                break;
+            case OpCode::Ln:
+                unary_kernel<T, Ln>(operand[instr.lhs], reg, n);
+                break;
+            case OpCode::Exp:
+                unary_kernel<T, Exp>(operand[instr.lhs], reg, n);
+                break;
+            }
+        }
+        std::copy_n(operand[code.size() - 1], n, out.begin() + row);
+    }
+}
+
+// Registers hold the real parts of a block followed by its imaginary parts;
+// `operands[2 * i]` and `operands[2 * i + 1]` point at the two halves of register `i`
+template<typename T>
+template<typename R>
+void CompiledExpression<T>::evaluate_batch_split(
+    std::span<const std::span<const R>> real_columns,
+    std::span<const std::span<const R>> imag_columns,
+    std::span<R> real_out,
+    std::span<R> imag_out
+) requires std::same_as<T, ComplexNumber> {
+    if (real_columns.size() < variable_names.size() || imag_columns.size() < variable_names.size()) {
+        throw std::invalid_argument(std::format(
+            "Expected {} variable columns, got {} real and {} imaginary",
+            variable_names.size(), real_columns.size(), imag_columns.size()
+        ));
+    }
+    if (imag_out.size() != real_out.size()) {
+        throw std::invalid_argument("Real and imaginary outputs must have the same length");
+    }
+    for (std::size_t slot = 0; slot < variable_names.size(); ++slot) {
+        if (real_columns[slot].size() < real_out.size() || imag_columns[slot].size() < real_out.size()) {
+            throw std::invalid_argument(std::format(
+                "Column for variable \"{}\" is shorter than the output", variable_names[slot]
+            ));
+        }
+    }
+
+    SplitBuffers<R>& split = std::get<SplitBuffers<R>>(split_buffers);
+    split.registers.resize(2 * code.size() * BATCH_BLOCK_SIZE);
+    split.operands.resize(2 * code.size());
+
+    // Constants are rounded to the precision of the parts, as `convert` rounds them for real tapes
+    for (std::size_t i = 0; i < code.size(); ++i) {
+        R* const re = split.registers.data() + 2 * i * BATCH_BLOCK_SIZE;
+        R* const im = re + BATCH_BLOCK_SIZE;
+        split.operands[2 * i] = re;
+        split.operands[2 * i + 1] = im;
+        if (code[i].op == OpCode::Const) {
+            std::fill_n(re, BATCH_BLOCK_SIZE, static_cast<R>(constant_pool[code[i].lhs].real()));
+            std::fill_n(im, BATCH_BLOCK_SIZE, static_cast<R>(constant_pool[code[i].lhs].imag()));
+        }
+    }
+
+    const R** const operand = split.operands.data();
+    for (std::size_t row = 0; row < real_out.size(); row += BATCH_BLOCK_SIZE) {
+        const std::size_t n = std::min(BATCH_BLOCK_SIZE, real_out.size() - row);
+        for (std::size_t i = 0; i < code.size(); ++i) {
+            const Instruction& instr = code[i];
+            R* const re = split.registers.data() + 2 * i * BATCH_BLOCK_SIZE;
+            R* const im = re + BATCH_BLOCK_SIZE;
+            const R* const* const lhs = operand + 2 * instr.lhs;
+            const R* const* const rhs = operand + 2 * instr.rhs;
+            switch (instr.op) {
+            case OpCode::Const:
+                break;
+            case OpCode::Var:
+                operand[2 * i] = real_columns[instr.lhs].data() + row;
+                operand[2 * i + 1] = imag_columns[instr.lhs].data() + row;
+                break;
+            case OpCode::Add:
+                split_arithmetic_kernel<R, SplitAdd>(lhs[0], lhs[1], rhs[0], rhs[1], re, im, n);
+                break;
+            case OpCode::Sub:
+                split_arithmetic_kernel<R, SplitSub>(lhs[0], lhs[1], rhs[0], rhs[1], re, im, n);
+                break;
+            case OpCode::Mul:
+                split_arithmetic_kernel<R, SplitMul>(lhs[0], lhs[1], rhs[0], rhs[1], re, im, n);
+                break;
+            case OpCode::Div:
+                split_arithmetic_kernel<R, SplitDiv>(lhs[0], lhs[1], rhs[0], rhs[1], re, im, n);
+                break;
+            case OpCode::Pow:
+                split_binary_kernel<R, SplitPow>(lhs[0], lhs[1], rhs[0], rhs[1], re, im, n);
+                break;
+            case OpCode::Sin:
+                split_unary_kernel<R, SplitSin>(lhs[0], lhs[1], re, im, n);
+                break;
+            case OpCode::Cos:
+                split_unary_kernel<R, SplitCos>(lhs[0], lhs[1], re, im, n);
+                break;
+            case OpCode::Ln:
+                split_unary_kernel<R, SplitLn>(lhs[0], lhs[1], re, im, n);
+                break;
+            case OpCode::Exp:
+                split_unary_kernel<R, SplitExp>(lhs[0], lhs[1], re, im, n);
+                break;
+            }
+        }
+        const std::size_t result = 2 * (code.size() - 1);
+        std::copy_n(operand[result], n, real_out.begin() + row);
+        std::copy_n(operand[result + 1], n, imag_out.begin() + row);
+    }
+}
+
+template void CompiledExpression<RealNumber>::evaluate_batch(
+    std::span<const std::span<const RealNumber>>, std::span<RealNumber>
+);
+template void CompiledExpression<double>::evaluate_batch(
+    std::span<const std::span<const double>>, std::span<double>
+);
+template void CompiledExpression<float>::evaluate_batch(
+    std::span<const std::span<const float>>, std::span<float>
+);
+template void CompiledExpression<ComplexNumber>::evaluate_batch(
+    std::span<const std::span<const ComplexNumber>>, std::span<ComplexNumber>
+);
+
+template void CompiledExpression<ComplexNumber>::evaluate_batch_split(
+    std::span<const std::span<const double>>, std::span<const std::span<const double>>,
+    std::span<double>, std::span<double>
+);
+template void CompiledExpression<ComplexNumber>::evaluate_batch_split(
+    std::span<const std::span<const float>>, std::span<const std::span<const float>>,
+    std::span<float>, std::span<float>
+);
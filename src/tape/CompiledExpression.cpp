@@ -0,0 +1,162 @@
+#include "Tape.hpp"
+
+#include <cmath>
+#include <format>
+#include <stdexcept>
+
+template<typename T>
+template<typename U>
+void CompiledExpression<T>::step(const std::size_t index, std::span<const U> values, U* const reg) const {
+    // Unqualified calls so that `Dual` finds its overloads
+    using std::pow, std::sin, std::cos, std::log, std::exp;
+
+    const Instruction& instr = code[index];
+    switch (instr.op) {
+    case OpCode::Const:
+        reg[index] = U(constant_pool[instr.lhs]);
+        break;
+    case OpCode::Var:
+        reg[index] = values[instr.lhs];
+        break;
+    case OpCode::Add:
+        reg[index] = reg[instr.lhs] + reg[instr.rhs];
+        break;
+    case OpCode::Sub:
+        reg[index] = reg[instr.lhs] - reg[instr.rhs];
+        break;
+    case OpCode::Mul:
+        reg[index] = reg[instr.lhs] * reg[instr.rhs];
+        break;
+    case OpCode::Div:
+        reg[index] = reg[instr.lhs] / reg[instr.rhs];
+        break;
+    case OpCode::Pow:
+        reg[index] = pow(reg[instr.lhs], reg[instr.rhs]);
+        break;
+    case OpCode::Sin:
+        reg[index] = sin(reg[instr.lhs]);
+        break;
+    case OpCode::Cos:
+        reg[index] = cos(reg[instr.lhs]);
+        break;
+    case OpCode::Ln:
+        reg[index] = log(reg[instr.lhs]);
+        break;
+    case OpCode::Exp:
+        reg[index] = exp(reg[instr.lhs]);
+        break;
+    }
+}
+
+template<typename T>
+template<typename U>
+void CompiledExpression<T>::interpret(std::span<const U> values, U* const reg) const {
+    for (std::size_t i = 0; i < code.size(); ++i) {
+        step(i, values, reg);
+    }
+}
+
+template<typename T>
+void CompiledExpression<T>::execute(std::span<const T> values) {
+    if (values.size() < variable_names.size()) {
+        throw std::invalid_argument(std::format(
+            "Expected {} variable values, got {}", variable_names.size(), values.size()
+        ));
+    }
+    interpret(values, registers.data());
+}
+
+template<typename T>
+T CompiledExpression<T>::evaluate(std::span<const T> values) {
+    execute(values);
+    return registers.back();
+}
+
+template<typename T>
+void CompiledExpression<T>::evaluate_outputs(
+    std::span<const T> values, std::span<const std::uint32_t> outputs, std::span<T> out
+) {
+    if (out.size() < outputs.size()) {
+        throw std::invalid_argument(std::format(
+            "Expected room for {} outputs, got {}", outputs.size(), out.size()
+        ));
+    }
+    execute(values);
+    for (std::size_t i = 0; i < outputs.size(); ++i) {
+        out[i] = registers[outputs[i]];
+    }
+}
+
+template<typename T>
+T CompiledExpression<T>::evaluate(const std::unordered_map<std::string, T>& values) {
+    for (std::size_t slot = 0; slot < variable_names.size(); ++slot) {
+        const auto it = values.find(variable_names[slot]);
+        if (it == values.end()) {
+            throw std::runtime_error(std::format("Can not resolve variable \"{}\"", variable_names[slot]));
+        }
+        bound_values[slot] = it->second;
+    }
+    return evaluate(bound_values);
+}
+
+template<typename T>
+const std::vector<std::string>& CompiledExpression<T>::variables() const {
+    return variable_names;
+}
+
+template<typename T>
+const std::vector<Instruction>& CompiledExpression<T>::instructions() const {
+    return code;
+}
+
+template<typename T>
+const std::vector<T>& CompiledExpression<T>::constants() const {
+    return constant_pool;
+}
+
+template<typename T>
+std::size_t CompiledExpression<T>::size() const {
+    return code.size();
+}
+
+template<typename T>
+template<typename U>
+CompiledExpression<U> CompiledExpression<T>::convert() const {
+    CompiledExpression<U> tape;
+    tape.code = code;
+    tape.variable_names = variable_names;
+    tape.constant_pool.reserve(constant_pool.size());
+    for (const T value : constant_pool) {
+        tape.constant_pool.push_back(static_cast<U>(value));
+    }
+    tape.registers.resize(tape.code.size());
+    tape.bound_values.resize(tape.variable_names.size());
+    return tape;
+}
+
+template class CompiledExpression<RealNumber>;
+template class CompiledExpression<double>;
+template class CompiledExpression<float>;
+template class CompiledExpression<ComplexNumber>;
+
+template void CompiledExpression<RealNumber>::interpret(std::span<const RealNumber>, RealNumber*) const;
+template void CompiledExpression<double>::interpret(std::span<const double>, double*) const;
+template void CompiledExpression<float>::interpret(std::span<const float>, float*) const;
+template void CompiledExpression<ComplexNumber>::interpret(std::span<const ComplexNumber>, ComplexNumber*) const;
+
+template void CompiledExpression<RealNumber>::interpret(std::span<const Dual<RealNumber>>, Dual<RealNumber>*) const;
+template void CompiledExpression<double>::interpret(std::span<const Dual<double>>, Dual<double>*) const;
+template void CompiledExpression<float>::interpret(std::span<const Dual<float>>, Dual<float>*) const;
+template void CompiledExpression<ComplexNumber>::interpret(std::span<const Dual<ComplexNumber>>, Dual<ComplexNumber>*) const;
+
+template void CompiledExpression<RealNumber>::step(std::size_t, std::span<const RealNumber>, RealNumber*) const;
+template void CompiledExpression<double>::step(std::size_t, std::span<const double>, double*) const;
+template void CompiledExpression<float>::step(std::size_t, std::span<const float>, float*) const;
+template void CompiledExpression<ComplexNumber>::step(std::size_t, std::span<const ComplexNumber>, ComplexNumber*) const;
+
+template CompiledExpression<double> CompiledExpression<RealNumber>::convert() const;
+template CompiledExpression<float> CompiledExpression<RealNumber>::convert() const;
+template CompiledExpression<RealNumber> CompiledExpression<double>::convert() const;
+template CompiledExpression<float> CompiledExpression<double>::convert() const;
+template CompiledExpression<RealNumber> CompiledExpression<float>::convert() const;
+template CompiledExpression<double> CompiledExpression<float>::convert() const;
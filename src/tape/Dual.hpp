@@ -0,0 +1,76 @@
+#ifndef DUAL_HPP
+#define DUAL_HPP
+
+#include <cmath>
+#include <complex>
+
+/// Dual number `value + derivative * e` with e^2 = 0: arithmetic on it carries a first derivative along.
+template<typename T>
+struct Dual {
+    T value;
+    T derivative;
+
+    Dual() : value(0), derivative(0) {}
+    Dual(const T _value) : value(_value), derivative(0) {}
+    Dual(const T _value, const T _derivative) : value(_value), derivative(_derivative) {}
+};
+
+template<typename T>
+Dual<T> operator+(const Dual<T>& lhs, const Dual<T>& rhs) {
+    return {lhs.value + rhs.value, lhs.derivative + rhs.derivative};
+}
+
+template<typename T>
+Dual<T> operator-(const Dual<T>& lhs, const Dual<T>& rhs) {
+    return {lhs.value - rhs.value, lhs.derivative - rhs.derivative};
+}
+
+template<typename T>
+Dual<T> operator*(const Dual<T>& lhs, const Dual<T>& rhs) {
+    return {lhs.value * rhs.value, lhs.derivative * rhs.value + lhs.value * rhs.derivative};
+}
+
+template<typename T>
+Dual<T> operator/(const Dual<T>& lhs, const Dual<T>& rhs) {
+    const T value = lhs.value / rhs.value;
+    return {value, (lhs.derivative - value * rhs.derivative) / rhs.value};
+}
+
+template<typename T>
+Dual<T> pow(const Dual<T>& lhs, const Dual<T>& rhs) {
+    using std::pow, std::log;
+    const T value = pow(lhs.value, rhs.value);
+    T derivative = lhs.derivative == T(0) ? T(0) : rhs.value * pow(lhs.value, rhs.value - T(1)) * lhs.derivative;
+    // A constant exponent needs no logarithm (which is undefined for base <= 0)
+    if (rhs.derivative != T(0)) {
+        derivative += value * log(lhs.value) * rhs.derivative;
+    }
+    return {value, derivative};
+}
+
+template<typename T>
+Dual<T> sin(const Dual<T>& arg) {
+    using std::sin, std::cos;
+    return {sin(arg.value), cos(arg.value) * arg.derivative};
+}
+
+template<typename T>
+Dual<T> cos(const Dual<T>& arg) {
+    using std::sin, std::cos;
+    return {cos(arg.value), -sin(arg.value) * arg.derivative};
+}
+
+template<typename T>
+Dual<T> log(const Dual<T>& arg) {
+    using std::log;
+    return {log(arg.value), arg.derivative / arg.value};
+}
+
+template<typename T>
+Dual<T> exp(const Dual<T>& arg) {
+    using std::exp;
+    const T value = exp(arg.value);
+    return {value, value * arg.derivative};
+}
+
+#endif  // DUAL_HPP
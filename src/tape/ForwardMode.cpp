@@ -0,0 +1,55 @@
+#include "Tape.hpp"
+
+#include <format>
+#include <stdexcept>
+
+template<typename T>
+Dual<T> CompiledExpression<T>::directional(std::span<const T> values, std::span<const T> direction) {
+    if (direction.size() < variable_names.size()) {
+        throw std::invalid_argument(std::format(
+            "Expected {} direction components, got {}", variable_names.size(), direction.size()
+        ));
+    }
+    seed_duals(values);
+    for (std::size_t slot = 0; slot < variable_names.size(); ++slot) {
+        dual_values[slot].derivative = direction[slot];
+    }
+    interpret<Dual<T>>(dual_values, dual_registers.data());
+    return dual_registers.back();
+}
+
+template<typename T>
+Dual<T> CompiledExpression<T>::derivative(std::span<const T> values, const std::uint32_t by) {
+    if (by >= variable_names.size()) {
+        throw std::invalid_argument(std::format(
+            "Variable slot {} is out of range for {} variables", by, variable_names.size()
+        ));
+    }
+    seed_duals(values);
+    dual_values[by].derivative = T(1);
+    interpret<Dual<T>>(dual_values, dual_registers.data());
+    return dual_registers.back();
+}
+
+template<typename T>
+void CompiledExpression<T>::seed_duals(std::span<const T> values) {
+    if (values.size() < variable_names.size()) {
+        throw std::invalid_argument(std::format(
+            "Expected {} variable values, got {}", variable_names.size(), values.size()
+        ));
+    }
+    dual_values.resize(variable_names.size());
+    for (std::size_t slot = 0; slot < variable_names.size(); ++slot) {
+        dual_values[slot] = Dual<T>(values[slot]);
+    }
+    dual_registers.resize(code.size());
+}
+
+template Dual<RealNumber> CompiledExpression<RealNumber>::directional(std::span<const RealNumber>, std::span<const RealNumber>);
+template Dual<double> CompiledExpression<double>::directional(std::span<const double>, std::span<const double>);
+template Dual<float> CompiledExpression<float>::directional(std::span<const float>, std::span<const float>);
+template Dual<ComplexNumber> CompiledExpression<ComplexNumber>::directional(std::span<const ComplexNumber>, std::span<const ComplexNumber>);
+template Dual<RealNumber> CompiledExpression<RealNumber>::derivative(std::span<const RealNumber>, std::uint32_t);
+template Dual<double> CompiledExpression<double>::derivative(std::span<const double>, std::uint32_t);
+template Dual<float> CompiledExpression<float>::derivative(std::span<const float>, std::uint32_t);
+template Dual<ComplexNumber> CompiledExpression<ComplexNumber>::derivative(std::span<const ComplexNumber>, std::uint32_t);
@@ -0,0 +1,78 @@
+#include "Tape.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <stdexcept>
+
+template<typename T>
+T CompiledExpression<T>::gradient(std::span<const T> values, std::span<T> partials) {
+    if (partials.size() < variable_names.size()) {
+        throw std::invalid_argument(std::format(
+            "Expected room for {} partial derivatives, got {}", variable_names.size(), partials.size()
+        ));
+    }
+    execute(values);
+
+    adjoints.assign(code.size(), T(0));
+    std::fill_n(partials.begin(), variable_names.size(), T(0));
+    adjoints.back() = T(1);
+
+    const T* const reg = registers.data();
+    T* const adj = adjoints.data();
+    for (std::size_t i = code.size(); i-- > 0;) {
+        const Instruction& instr = code[i];
+        const T seed = adj[i];
+        if (seed == T(0)) {
+            continue;
+        }
+        switch (instr.op) {
+        case OpCode::Const:
+            break;
+        case OpCode::Var:
+            partials[instr.lhs] += seed;
+            break;
+        case OpCode::Add:
+            adj[instr.lhs] += seed;
+            adj[instr.rhs] += seed;
+            break;
+        case OpCode::Sub:
+            adj[instr.lhs] += seed;
+            adj[instr.rhs] -= seed;
+            break;
+        case OpCode::Mul:
+            adj[instr.lhs] += seed * reg[instr.rhs];
+            adj[instr.rhs] += seed * reg[instr.lhs];
+            break;
+        case OpCode::Div:
+            adj[instr.lhs] += seed / reg[instr.rhs];
+            adj[instr.rhs] -= seed * reg[i] / reg[instr.rhs];
+            break;
+        case OpCode::Pow:
+            adj[instr.lhs] += seed * reg[instr.rhs] * std::pow(reg[instr.lhs], reg[instr.rhs] - T(1));
+            // Constant exponents are the common case and need no logarithm (which is undefined for base <= 0)
+            if (code[instr.rhs].op != OpCode::Const) {
+                adj[instr.rhs] += seed * reg[i] * std::log(reg[instr.lhs]);
+            }
+            break;
+        case OpCode::Sin:
+            adj[instr.lhs] += seed * std::cos(reg[instr.lhs]);
+            break;
+        case OpCode::Cos:
+            adj[instr.lhs] -= seed * std::sin(reg[instr.lhs]);
+            break;
+        case OpCode::Ln:
+            adj[instr.lhs] += seed / reg[instr.lhs];
+            break;
+        case OpCode::Exp:
+            adj[instr.lhs] += seed * reg[i];
+            break;
+        }
+    }
+    return reg[code.size() - 1];
+}
+
+template RealNumber CompiledExpression<RealNumber>::gradient(std::span<const RealNumber>, std::span<RealNumber>);
+template double CompiledExpression<double>::gradient(std::span<const double>, std::span<double>);
+template float CompiledExpression<float>::gradient(std::span<const float>, std::span<float>);
+template ComplexNumber CompiledExpression<ComplexNumber>::gradient(std::span<const ComplexNumber>, std::span<ComplexNumber>);
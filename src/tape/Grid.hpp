@@ -0,0 +1,40 @@
+#ifndef GRID_HPP
+#define GRID_HPP
+
+#include "Tape.hpp"
+#include "../parallel/WorkStealingPool.hpp"
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+/// Cartesian product of per-variable axes. Points are numbered row-major in the order the axes
+/// were added: the last axis varies fastest.
+template<typename T = RealNumber>
+class Grid {
+public:
+    /// Adds the axis `start, start + step, ...` up to and including `stop`.
+    Grid& range(const std::string& variable, T start, T stop, T step);
+    /// Adds an axis of explicit values.
+    Grid& points(const std::string& variable, std::vector<T> values);
+
+    /// Number of points, the product of the axis lengths.
+    std::size_t size() const;
+    const std::vector<std::string>& variables() const;
+    const std::vector<T>& axis(std::size_t index) const;
+
+    /// Evaluates `tape` at every point into `out[point]`. Work is split into chunks of neighbouring
+    /// points that `pool` schedules; each worker evaluates its chunks in batches on its own copy of the tape.
+    void evaluate(
+        const CompiledExpression<T>& tape,
+        std::span<T> out,
+        WorkStealingPool& pool = WorkStealingPool::shared()
+    ) const;
+
+private:
+    std::vector<std::string> variable_names;
+    std::vector<std::vector<T>> axes;
+};
+
+#endif  // GRID_HPP
@@ -0,0 +1,130 @@
+#include "Grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <stdexcept>
+
+namespace {
+
+// Points per scheduled chunk: a few evaluation blocks, small enough to balance the load
+constexpr std::size_t GRID_CHUNK_SIZE = 4096;
+
+}  // namespace
+
+template<typename T>
+Grid<T>& Grid<T>::range(const std::string& variable, const T start, const T stop, const T step) {
+    const auto steps = std::real((stop - start) / step);
+    if (!std::isfinite(steps) || steps < 0) {
+        throw std::invalid_argument(std::format(
+            "Step of the axis \"{}\" does not lead from its start to its stop", variable
+        ));
+    }
+    // Tolerates the rounding of a step that divides the range exactly on paper
+    const auto count = static_cast<std::size_t>(std::floor(steps + 1e-9L)) + 1;
+
+    std::vector<T> values(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        values[i] = start + step * T(i);
+    }
+    return points(variable, std::move(values));
+}
+
+template<typename T>
+Grid<T>& Grid<T>::points(const std::string& variable, std::vector<T> values) {
+    if (std::find(variable_names.begin(), variable_names.end(), variable) != variable_names.end()) {
+        throw std::invalid_argument(std::format("Grid already has an axis \"{}\"", variable));
+    }
+    variable_names.push_back(variable);
+    axes.push_back(std::move(values));
+    return *this;
+}
+
+template<typename T>
+std::size_t Grid<T>::size() const {
+    std::size_t count = 1;
+    for (const std::vector<T>& values : axes) {
+        count *= values.size();
+    }
+    return count;
+}
+
+template<typename T>
+const std::vector<std::string>& Grid<T>::variables() const {
+    return variable_names;
+}
+
+template<typename T>
+const std::vector<T>& Grid<T>::axis(const std::size_t index) const {
+    return axes[index];
+}
+
+template<typename T>
+void Grid<T>::evaluate(const CompiledExpression<T>& tape, std::span<T> out, WorkStealingPool& pool) const {
+    const std::size_t total = size();
+    if (out.size() < total) {
+        throw std::invalid_argument(std::format(
+            "Expected room for {} grid points, got {}", total, out.size()
+        ));
+    }
+
+    // Axis feeding each variable slot of the tape
+    std::vector<std::size_t> slot_axes;
+    for (const std::string& name : tape.variables()) {
+        const auto it = std::find(variable_names.begin(), variable_names.end(), name);
+        if (it == variable_names.end()) {
+            throw std::runtime_error(std::format("Can not resolve variable \"{}\"", name));
+        }
+        slot_axes.push_back(it - variable_names.begin());
+    }
+
+    // Everything a worker touches is allocated here, so evaluation itself never allocates
+    struct Worker {
+        CompiledExpression<T> tape;
+        std::vector<std::vector<T>> columns;
+        std::vector<std::span<const T>> column_spans;
+        std::vector<std::size_t> index;
+    };
+    std::vector<Worker> workers(pool.size(), Worker{tape, {}, {}, {}});
+    for (Worker& worker : workers) {
+        worker.columns.assign(slot_axes.size(), std::vector<T>(GRID_CHUNK_SIZE));
+        for (const std::vector<T>& column : worker.columns) {
+            worker.column_spans.emplace_back(column);
+        }
+        worker.index.resize(axes.size());
+        // Sizes the batch registers up front
+        worker.tape.evaluate_batch(worker.column_spans, std::span<T>());
+    }
+
+    const std::size_t chunk_count = (total + GRID_CHUNK_SIZE - 1) / GRID_CHUNK_SIZE;
+    pool.parallel_for(chunk_count, [&](const std::size_t worker_id, const std::size_t chunk) {
+        Worker& worker = workers[worker_id];
+        const std::size_t begin = chunk * GRID_CHUNK_SIZE;
+        const std::size_t rows = std::min(GRID_CHUNK_SIZE, total - begin);
+
+        // Multi-index of the first point, then advanced like an odometer
+        std::size_t rest = begin;
+        for (std::size_t a = axes.size(); a-- > 0;) {
+            worker.index[a] = rest % axes[a].size();
+            rest /= axes[a].size();
+        }
+        for (std::size_t row = 0; row < rows; ++row) {
+            for (std::size_t slot = 0; slot < slot_axes.size(); ++slot) {
+                const std::size_t a = slot_axes[slot];
+                worker.columns[slot][row] = axes[a][worker.index[a]];
+            }
+            for (std::size_t a = axes.size(); a-- > 0;) {
+                if (++worker.index[a] < axes[a].size()) {
+                    break;
+                }
+                worker.index[a] = 0;
+            }
+        }
+        worker.tape.evaluate_batch(worker.column_spans, out.subspan(begin, rows));
+    });
+}
+
+template class Grid<RealNumber>;
+template class Grid<double>;
+template class Grid<float>;
+template class Grid<ComplexNumber>;
@@ -0,0 +1,61 @@
+#ifndef INCREMENTAL_HPP
+#define INCREMENTAL_HPP
+
+#include "Tape.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Keeps the value of every instruction of a tape between evaluations. When some variables change,
+/// only the instructions that depend on them are recomputed, in tape order, so every path from
+/// a changed variable to the result is updated exactly once.
+template<typename T = RealNumber>
+class IncrementalEvaluator {
+public:
+    explicit IncrementalEvaluator(CompiledExpression<T> tape);
+
+    /// Binds every variable (in `variables()` order) and recomputes whatever differs from the
+    /// previous binding. The first call computes the whole tape.
+    T evaluate(std::span<const T> values);
+    T evaluate(const std::unordered_map<std::string, T>& values);
+    /// Changes one variable of an evaluated tape.
+    T set(std::uint32_t slot, T value);
+    T set(const std::string& variable, T value);
+
+    /// Result of the last evaluation.
+    T value() const;
+    /// Number of instructions the last evaluation recomputed.
+    std::size_t recomputed() const;
+
+    const std::vector<std::string>& variables() const;
+
+private:
+    CompiledExpression<T> tape;
+    std::vector<T> registers;
+    std::vector<T> bound_values;
+    bool evaluated = false;
+    std::size_t last_recomputed = 0;
+
+    /// Instructions that read register `i`: `users[user_offsets[i] .. user_offsets[i + 1])`.
+    std::vector<std::uint32_t> user_offsets;
+    std::vector<std::uint32_t> users;
+    /// `Var` instructions that read slot `s`: `readers[reader_offsets[s] .. reader_offsets[s + 1])`.
+    std::vector<std::uint32_t> reader_offsets;
+    std::vector<std::uint32_t> readers;
+
+    /// Instructions to recompute, found from the changed slots; `marked` flags the ones in `dirty`.
+    std::vector<std::uint32_t> dirty;
+    std::vector<bool> marked;
+
+    // Adds every instruction that depends on `slot` to `dirty`
+    void mark(std::uint32_t slot);
+    // Recomputes `dirty` in tape order and clears it
+    void recompute_dirty();
+    std::uint32_t slot_of(const std::string& variable) const;
+};
+
+#endif  // INCREMENTAL_HPP
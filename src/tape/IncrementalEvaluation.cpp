@@ -0,0 +1,230 @@
+#include "Incremental.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <format>
+#include <stdexcept>
+
+namespace {
+
+// Builds compressed lists from (key, value) pairs: the values of key `k` end up in
+// `values[offsets[k] .. offsets[k + 1])`, in the order the pairs were added
+class ListBuilder {
+public:
+    explicit ListBuilder(const std::size_t keys) : offsets(keys + 1) {}
+
+    void count(const std::uint32_t key) {
+        ++offsets[key + 1];
+    }
+
+    // After every pair has been counted
+    void allocate() {
+        for (std::size_t key = 1; key < offsets.size(); ++key) {
+            offsets[key] += offsets[key - 1];
+        }
+        values.resize(offsets.back());
+        cursors.assign(offsets.begin(), offsets.end() - 1);
+    }
+
+    void add(const std::uint32_t key, const std::uint32_t value) {
+        values[cursors[key]++] = value;
+    }
+
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> values;
+
+private:
+    std::vector<std::uint32_t> cursors;
+};
+
+// Whether a new value can skip the recomputation. 0 and -0 compare equal but differ in results
+// such as 1 / x, so the sign is compared too; NaN never matches and is always recomputed
+template<typename R>
+bool same_value(const R lhs, const R rhs) {
+    return lhs == rhs && std::signbit(lhs) == std::signbit(rhs);
+}
+
+template<typename R>
+bool same_value(const std::complex<R> lhs, const std::complex<R> rhs) {
+    return same_value(lhs.real(), rhs.real()) && same_value(lhs.imag(), rhs.imag());
+}
+
+bool is_unary(const OpCode op) {
+    return op == OpCode::Sin || op == OpCode::Cos || op == OpCode::Ln || op == OpCode::Exp;
+}
+
+}  // namespace
+
+template<typename T>
+IncrementalEvaluator<T>::IncrementalEvaluator(CompiledExpression<T> tape)
+    : tape(std::move(tape)) {
+    const std::vector<Instruction>& code = this->tape.instructions();
+    registers.resize(code.size());
+    bound_values.resize(this->tape.variables().size());
+    marked.resize(code.size());
+
+    // Only the edges of the tape are stored, so setup is linear in its size whatever the number
+    // of variables; the instructions a change reaches are found by following them
+    // Calls `on_use(operand, i)` for every operand register of instruction `i`, and
+    // `on_read(slot, i)` for every variable it reads
+    const auto for_each_edge = [&code](const auto& on_use, const auto& on_read) {
+        for (std::uint32_t i = 0; i < code.size(); ++i) {
+            const Instruction& instr = code[i];
+            if (instr.op == OpCode::Const) {
+                continue;
+            }
+            if (instr.op == OpCode::Var) {
+                on_read(instr.lhs, i);
+                continue;
+            }
+            on_use(instr.lhs, i);
+            if (!is_unary(instr.op)) {
+                on_use(instr.rhs, i);
+            }
+        }
+    };
+    ListBuilder user_lists(code.size());
+    ListBuilder reader_lists(bound_values.size());
+    for_each_edge(
+        [&](const std::uint32_t operand, std::uint32_t) { user_lists.count(operand); },
+        [&](const std::uint32_t slot, std::uint32_t) { reader_lists.count(slot); }
+    );
+    user_lists.allocate();
+    reader_lists.allocate();
+    for_each_edge(
+        [&](const std::uint32_t operand, const std::uint32_t i) { user_lists.add(operand, i); },
+        [&](const std::uint32_t slot, const std::uint32_t i) { reader_lists.add(slot, i); }
+    );
+    user_offsets = std::move(user_lists.offsets);
+    users = std::move(user_lists.values);
+    reader_offsets = std::move(reader_lists.offsets);
+    readers = std::move(reader_lists.values);
+}
+
+template<typename T>
+void IncrementalEvaluator<T>::mark(const std::uint32_t slot) {
+    std::size_t next = dirty.size();
+    for (std::uint32_t k = reader_offsets[slot]; k < reader_offsets[slot + 1]; ++k) {
+        if (!marked[readers[k]]) {
+            marked[readers[k]] = true;
+            dirty.push_back(readers[k]);
+        }
+    }
+    // Users of instructions marked before are marked already, so only the new ones are followed
+    for (; next < dirty.size(); ++next) {
+        const std::uint32_t i = dirty[next];
+        for (std::uint32_t k = user_offsets[i]; k < user_offsets[i + 1]; ++k) {
+            if (!marked[users[k]]) {
+                marked[users[k]] = true;
+                dirty.push_back(users[k]);
+            }
+        }
+    }
+}
+
+template<typename T>
+void IncrementalEvaluator<T>::recompute_dirty() {
+    // Operands come before the instructions reading them, so tape order updates each one once
+    std::sort(dirty.begin(), dirty.end());
+    for (const std::uint32_t i : dirty) {
+        tape.template step<T>(i, bound_values, registers.data());
+        marked[i] = false;
+    }
+    last_recomputed = dirty.size();
+    dirty.clear();
+}
+
+template<typename T>
+T IncrementalEvaluator<T>::evaluate(std::span<const T> values) {
+    if (values.size() < bound_values.size()) {
+        throw std::invalid_argument(std::format(
+            "Expected {} variable values, got {}", bound_values.size(), values.size()
+        ));
+    }
+
+    if (!evaluated) {
+        std::copy_n(values.begin(), bound_values.size(), bound_values.begin());
+        tape.template interpret<T>(bound_values, registers.data());
+        evaluated = true;
+        last_recomputed = registers.size();
+        return value();
+    }
+
+    for (std::uint32_t slot = 0; slot < bound_values.size(); ++slot) {
+        if (same_value(values[slot], bound_values[slot])) {
+            continue;
+        }
+        bound_values[slot] = values[slot];
+        mark(slot);
+    }
+    recompute_dirty();
+    return value();
+}
+
+template<typename T>
+T IncrementalEvaluator<T>::evaluate(const std::unordered_map<std::string, T>& values) {
+    std::vector<T> slots(bound_values.size());
+    for (std::size_t slot = 0; slot < slots.size(); ++slot) {
+        const std::string& name = tape.variables()[slot];
+        const auto it = values.find(name);
+        if (it == values.end()) {
+            throw std::runtime_error(std::format("Can not resolve variable \"{}\"", name));
+        }
+        slots[slot] = it->second;
+    }
+    return evaluate(slots);
+}
+
+template<typename T>
+T IncrementalEvaluator<T>::set(const std::uint32_t slot, const T value) {
+    if (!evaluated) {
+        throw std::runtime_error("Incremental evaluator has not been evaluated yet");
+    }
+    if (slot >= bound_values.size()) {
+        throw std::invalid_argument(std::format("Variable slot {} is out of range", slot));
+    }
+    last_recomputed = 0;
+    if (same_value(value, bound_values[slot])) {
+        return this->value();
+    }
+    bound_values[slot] = value;
+    mark(slot);
+    recompute_dirty();
+    return this->value();
+}
+
+template<typename T>
+T IncrementalEvaluator<T>::set(const std::string& variable, const T value) {
+    return set(slot_of(variable), value);
+}
+
+template<typename T>
+std::uint32_t IncrementalEvaluator<T>::slot_of(const std::string& variable) const {
+    const std::vector<std::string>& names = tape.variables();
+    const auto it = std::find(names.begin(), names.end(), variable);
+    if (it == names.end()) {
+        throw std::runtime_error(std::format("Can not resolve variable \"{}\"", variable));
+    }
+    return static_cast<std::uint32_t>(it - names.begin());
+}
+
+template<typename T>
+T IncrementalEvaluator<T>::value() const {
+    return registers.back();
+}
+
+template<typename T>
+std::size_t IncrementalEvaluator<T>::recomputed() const {
+    return last_recomputed;
+}
+
+template<typename T>
+const std::vector<std::string>& IncrementalEvaluator<T>::variables() const {
+    return tape.variables();
+}
+
+template class IncrementalEvaluator<RealNumber>;
+template class IncrementalEvaluator<double>;
+template class IncrementalEvaluator<float>;
+template class IncrementalEvaluator<ComplexNumber>;
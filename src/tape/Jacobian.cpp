@@ -0,0 +1,134 @@
+#include "Jacobian.hpp"
+
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+
+template<typename T>
+Jacobian<T>::Jacobian(const std::vector<Expression<T>>& functions, const std::vector<std::string>& variables)
+    : row_count(functions.size()),
+      col_count(variables.size()),
+      entries(differentiate(functions, variables)),
+      tape(compile_entries()),
+      bound_values(tape.variables().size()) {}
+
+template<typename T>
+std::vector<Expression<T>> Jacobian<T>::differentiate(
+    const std::vector<Expression<T>>& functions, const std::vector<std::string>& variables
+) {
+    DiffCache<T> cache;
+    Simplifier<T> simplifier;
+    std::vector<Expression<T>> stored;
+
+    offsets.reserve(functions.size() + 1);
+    offsets.push_back(0);
+    for (const Expression<T>& function : functions) {
+        for (std::uint32_t col = 0; col < variables.size(); ++col) {
+            // The cache answers functions that do not depend on the variable with its zero node
+            const auto derivative = cache.diff(function.inner, variables[col]);
+            if (derivative == cache.zero()) {
+                continue;
+            }
+            auto simplified = simplifier.simplify(derivative);
+            if (Simplifier<T>::is_constant(simplified, T(0))) {
+                continue;
+            }
+            column_indices.push_back(col);
+            stored.push_back(Expression<T>(std::move(simplified)));
+        }
+        offsets.push_back(stored.size());
+    }
+    return stored;
+}
+
+template<typename T>
+CompiledExpression<T> Jacobian<T>::compile_entries() {
+    // One builder for all entries, so subterms they share are emitted once
+    TapeBuilder<T> builder;
+    outputs.reserve(entries.size());
+    for (const Expression<T>& entry : entries) {
+        outputs.push_back(builder.lower(entry.inner));
+    }
+    return builder.finish();
+}
+
+template<typename T>
+std::size_t Jacobian<T>::rows() const {
+    return row_count;
+}
+
+template<typename T>
+std::size_t Jacobian<T>::cols() const {
+    return col_count;
+}
+
+template<typename T>
+std::size_t Jacobian<T>::nonzeros() const {
+    return entries.size();
+}
+
+template<typename T>
+std::size_t Jacobian<T>::find(const std::size_t row, const std::size_t col) const {
+    if (row >= row_count || col >= col_count) {
+        throw std::invalid_argument(std::format(
+            "Entry ({}, {}) is outside of the {}x{} Jacobian", row, col, row_count, col_count
+        ));
+    }
+    const auto begin = column_indices.begin() + offsets[row];
+    const auto end = column_indices.begin() + offsets[row + 1];
+    const auto it = std::lower_bound(begin, end, col);
+    if (it == end || *it != col) {
+        return entries.size();
+    }
+    return it - column_indices.begin();
+}
+
+template<typename T>
+bool Jacobian<T>::is_zero(const std::size_t row, const std::size_t col) const {
+    return find(row, col) == entries.size();
+}
+
+template<typename T>
+Expression<T> Jacobian<T>::entry(const std::size_t row, const std::size_t col) const {
+    const std::size_t index = find(row, col);
+    return index == entries.size() ? Expression<T>(T(0)) : entries[index];
+}
+
+template<typename T>
+const std::vector<std::size_t>& Jacobian<T>::row_offsets() const {
+    return offsets;
+}
+
+template<typename T>
+const std::vector<std::uint32_t>& Jacobian<T>::columns() const {
+    return column_indices;
+}
+
+template<typename T>
+const std::vector<std::string>& Jacobian<T>::inputs() const {
+    return tape.variables();
+}
+
+template<typename T>
+void Jacobian<T>::evaluate(std::span<const T> values, std::span<T> nonzeros) {
+    tape.evaluate_outputs(values, outputs, nonzeros);
+}
+
+template<typename T>
+SparseMatrix<T> Jacobian<T>::evaluate(const std::unordered_map<std::string, T>& values) {
+    for (std::size_t slot = 0; slot < bound_values.size(); ++slot) {
+        const auto it = values.find(inputs()[slot]);
+        if (it == values.end()) {
+            throw std::runtime_error(std::format("Can not resolve variable \"{}\"", inputs()[slot]));
+        }
+        bound_values[slot] = it->second;
+    }
+    SparseMatrix<T> matrix{row_count, col_count, offsets, column_indices, std::vector<T>(entries.size())};
+    evaluate(bound_values, matrix.values);
+    return matrix;
+}
+
+template class Jacobian<RealNumber>;
+template class Jacobian<double>;
+template class Jacobian<float>;
+template class Jacobian<ComplexNumber>;
@@ -0,0 +1,75 @@
+#ifndef JACOBIAN_HPP
+#define JACOBIAN_HPP
+
+#include "Tape.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Compressed sparse rows: the entries of row `i` are `values[row_offsets[i] .. row_offsets[i + 1])`,
+/// in columns `columns[...]`.
+template<typename T = RealNumber>
+struct SparseMatrix {
+    std::size_t rows = 0;
+    std::size_t cols = 0;
+    std::vector<std::size_t> row_offsets;
+    std::vector<std::uint32_t> columns;
+    std::vector<T> values;
+};
+
+/// Jacobian of several functions by several variables, built jointly: all entries are differentiated
+/// through one `DiffCache` and simplified by one `Simplifier`, so subterms common to several entries
+/// are built once and shared. Entries that are structurally zero (the function does not depend on the
+/// variable, or the derivative simplifies to 0) are not stored. The stored entries are compiled into
+/// one tape, so evaluating the whole matrix is a single pass.
+template<typename T = RealNumber>
+class Jacobian {
+public:
+    Jacobian(const std::vector<Expression<T>>& functions, const std::vector<std::string>& variables);
+
+    std::size_t rows() const;
+    std::size_t cols() const;
+    /// Number of entries that are not structurally zero.
+    std::size_t nonzeros() const;
+
+    bool is_zero(std::size_t row, std::size_t col) const;
+    /// The derivative of function `row` by variable `col`.
+    Expression<T> entry(std::size_t row, std::size_t col) const;
+
+    /// Sparsity pattern in CSR form, shared by every evaluation.
+    const std::vector<std::size_t>& row_offsets() const;
+    const std::vector<std::uint32_t>& columns() const;
+
+    /// Variables the entries use, in the order `evaluate` takes their values. Besides the
+    /// differentiation variables this includes any parameters of the functions.
+    const std::vector<std::string>& inputs() const;
+
+    /// Writes the stored entries, in CSR order, into `nonzeros`.
+    void evaluate(std::span<const T> values, std::span<T> nonzeros);
+    SparseMatrix<T> evaluate(const std::unordered_map<std::string, T>& values);
+
+private:
+    std::size_t row_count;
+    std::size_t col_count;
+    std::vector<std::size_t> offsets;
+    std::vector<std::uint32_t> column_indices;
+    std::vector<Expression<T>> entries;
+    std::vector<std::uint32_t> outputs;
+    CompiledExpression<T> tape;
+    std::vector<T> bound_values;
+
+    // Fill `offsets` and `column_indices` and return the stored entries
+    std::vector<Expression<T>> differentiate(
+        const std::vector<Expression<T>>& functions, const std::vector<std::string>& variables
+    );
+    // Fills `outputs` and returns the joint tape of `entries`
+    CompiledExpression<T> compile_entries();
+    // Position of entry (row, col) among the stored ones, or `nonzeros()` for a zero
+    std::size_t find(std::size_t row, std::size_t col) const;
+};
+
+#endif  // JACOBIAN_HPP
@@ -0,0 +1,99 @@
+#include "Precision.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Largest deviation of the tape converted to `U` from `reference`
+template<typename U>
+RealNumber max_error(
+    const CompiledExpression<RealNumber>& tape,
+    std::span<const std::span<const RealNumber>> columns,
+    const std::vector<RealNumber>& reference
+) {
+    CompiledExpression<U> converted = tape.template convert<U>();
+
+    std::vector<std::vector<U>> storage;
+    std::vector<std::span<const U>> converted_columns;
+    storage.reserve(columns.size());
+    for (const auto& column : columns) {
+        storage.emplace_back(column.begin(), column.end());
+        converted_columns.emplace_back(storage.back());
+    }
+    std::vector<U> results(reference.size());
+    converted.evaluate_batch(converted_columns, results);
+
+    RealNumber error = 0;
+    for (std::size_t i = 0; i < reference.size(); ++i) {
+        if (!std::isfinite(reference[i])) {
+            continue;
+        }
+        const RealNumber value = results[i];
+        if (!std::isfinite(value)) {
+            return std::numeric_limits<RealNumber>::infinity();
+        }
+        const RealNumber scale = std::max<RealNumber>(std::abs(reference[i]), 1);
+        error = std::max(error, std::abs(value - reference[i]) / scale);
+    }
+    return error;
+}
+
+}  // namespace
+
+Precision parse_precision(const std::string_view name) {
+    if (name == "float") {
+        return Precision::Float;
+    }
+    if (name == "double") {
+        return Precision::Double;
+    }
+    if (name == "long") {
+        return Precision::LongDouble;
+    }
+    throw std::invalid_argument(std::format("Unknown precision \"{}\"", name));
+}
+
+std::string_view precision_name(const Precision precision) {
+    switch (precision) {
+    case Precision::Float:
+        return "float";
+    case Precision::Double:
+        return "double";
+    default:
+        return "long";
+    }
+}
+
+PrecisionChoice choose_precision(
+    const CompiledExpression<RealNumber>& tape,
+    const std::span<const std::span<const RealNumber>> columns,
+    const RealNumber tolerance
+) {
+    const std::size_t count = columns.empty() ? 1 : columns.front().size();
+    for (const auto& column : columns) {
+        if (column.size() != count) {
+            throw std::invalid_argument("Sample columns must have the same length");
+        }
+    }
+
+    CompiledExpression<RealNumber> reference_tape = tape;
+    std::vector<RealNumber> reference(count);
+    reference_tape.evaluate_batch(columns, reference);
+
+    PrecisionChoice choice{
+        Precision::LongDouble,
+        max_error<float>(tape, columns, reference),
+        max_error<double>(tape, columns, reference),
+    };
+    if (choice.float_error <= tolerance) {
+        choice.precision = Precision::Float;
+    } else if (choice.double_error <= tolerance) {
+        choice.precision = Precision::Double;
+    }
+    return choice;
+}
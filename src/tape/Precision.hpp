@@ -0,0 +1,37 @@
+#ifndef PRECISION_HPP
+#define PRECISION_HPP
+
+#include "Tape.hpp"
+
+#include <span>
+#include <string>
+#include <string_view>
+
+/// Floating-point types a real-valued expression can be evaluated in, from the cheapest.
+enum class Precision {
+    Float,
+    Double,
+    LongDouble,
+};
+
+Precision parse_precision(std::string_view name);
+std::string_view precision_name(Precision precision);
+
+struct PrecisionChoice {
+    Precision precision;
+    /// Largest error of the float and double evaluations over the sample.
+    RealNumber float_error;
+    RealNumber double_error;
+};
+
+/// Picks the cheapest precision whose results over the sample stay within `tolerance` of long double.
+/// `columns` holds one column of sample points per variable, in `tape.variables()` order. Errors are
+/// relative where the reference exceeds 1 in magnitude and absolute elsewhere; points where long double
+/// itself is not finite are skipped.
+PrecisionChoice choose_precision(
+    const CompiledExpression<RealNumber>& tape,
+    std::span<const std::span<const RealNumber>> columns,
+    RealNumber tolerance
+);
+
+#endif  // PRECISION_HPP
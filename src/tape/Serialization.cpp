@@ -0,0 +1,343 @@
+#include "Tape.hpp"
+#include "../io/MappedFile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <unordered_set>
+
+// Layout; fixed-width integers are little-endian, "var" is an unsigned LEB128 varint:
+//   "SDEX"  u32 version  u8 number kind  u8[3] zero
+//   var variable count  var constant count  var instruction count
+//   variables:     var length, name bytes
+//   constants:     one scalar for reals, real and imaginary scalar for complex numbers
+//   instructions:  u8 op code, then for Const and Var the pool index or slot as a var, for other
+//                  ops every operand as a var distance back from the instruction's own index
+// A scalar starts with a tag byte whose bit 7 is the sign:
+//   0  integer, followed by its magnitude as a var
+//   1  other finite value: exponent as a zigzag var, u64 high and var low mantissa word
+//      (two words keep every bit of a long double up to 128-bit precision)
+//   2  infinity
+//   3  NaN
+
+namespace {
+
+constexpr std::array<char, 4> MAGIC = {'S', 'D', 'E', 'X'};
+constexpr std::uint32_t FORMAT_VERSION = 1;
+
+enum class NumberKind : std::uint8_t {
+    Real = 0,
+    Complex = 1
+};
+
+// Real numbers of every width share one kind: a tape saved in one precision loads in any other
+template<typename T>
+constexpr NumberKind NUMBER_KIND = NumberKind::Real;
+
+template<>
+constexpr NumberKind NUMBER_KIND<ComplexNumber> = NumberKind::Complex;
+
+enum ScalarTag : std::uint8_t {
+    Integer = 0,
+    Finite = 1,
+    Infinity = 2,
+    NotANumber = 3,
+    NEGATIVE = 0x80
+};
+
+class Writer {
+public:
+    explicit Writer(std::ostream& _out) : out(_out) {}
+
+    void bytes(const void* data, const std::size_t size) {
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    }
+
+    template<typename Int>
+    void integer(const Int value) {
+        std::array<unsigned char, sizeof(Int)> buffer;
+        for (std::size_t i = 0; i < sizeof(Int); ++i) {
+            buffer[i] = static_cast<unsigned char>(static_cast<std::uint64_t>(value) >> (8 * i));
+        }
+        bytes(buffer.data(), buffer.size());
+    }
+
+    void varint(std::uint64_t value) {
+        std::array<unsigned char, 10> buffer;
+        std::size_t size = 0;
+        do {
+            buffer[size++] = static_cast<unsigned char>((value & 0x7f) | (value >= 0x80 ? 0x80 : 0));
+            value >>= 7;
+        } while (value != 0);
+        bytes(buffer.data(), size);
+    }
+
+    void scalar(const RealNumber value) {
+        const std::uint8_t sign = std::signbit(value) ? NEGATIVE : 0;
+        const RealNumber magnitude = std::fabs(value);
+        if (std::isnan(value)) {
+            integer(static_cast<std::uint8_t>(NotANumber | sign));
+        } else if (std::isinf(value)) {
+            integer(static_cast<std::uint8_t>(Infinity | sign));
+        } else if (magnitude < 0x1p63L && std::trunc(magnitude) == magnitude) {
+            integer(static_cast<std::uint8_t>(Integer | sign));
+            varint(static_cast<std::uint64_t>(magnitude));
+        } else {
+            // The fraction is in [0.5, 1): peel off 64 mantissa bits at a time
+            int exponent = 0;
+            const RealNumber fraction = std::frexp(magnitude, &exponent);
+            const RealNumber high = std::floor(std::ldexp(fraction, 64));
+            integer(static_cast<std::uint8_t>(Finite | sign));
+            varint(static_cast<std::uint32_t>(exponent << 1) ^ static_cast<std::uint32_t>(exponent >> 31));
+            integer(static_cast<std::uint64_t>(high));
+            varint(static_cast<std::uint64_t>(std::ldexp(std::ldexp(fraction, 64) - high, 64)));
+        }
+    }
+
+    void number(const RealNumber value) {
+        scalar(value);
+    }
+
+    void number(const ComplexNumber value) {
+        scalar(value.real());
+        scalar(value.imag());
+    }
+
+private:
+    std::ostream& out;
+};
+
+class Reader {
+public:
+    explicit Reader(const std::span<const std::byte> _data) : data(_data) {}
+
+    const std::byte* bytes(const std::size_t size) {
+        if (data.size() - offset < size) {
+            throw std::runtime_error("Invalid expression file: unexpected end of data");
+        }
+        const std::byte* result = data.data() + offset;
+        offset += size;
+        return result;
+    }
+
+    template<typename Int>
+    Int integer() {
+        const std::byte* raw = bytes(sizeof(Int));
+        std::uint64_t value = 0;
+        for (std::size_t i = 0; i < sizeof(Int); ++i) {
+            value |= static_cast<std::uint64_t>(raw[i]) << (8 * i);
+        }
+        return static_cast<Int>(value);
+    }
+
+    std::uint64_t varint() {
+        std::uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            const auto byte = static_cast<std::uint64_t>(*bytes(1));
+            value |= (byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Invalid expression file: bad varint");
+    }
+
+    std::uint32_t varint32() {
+        const std::uint64_t value = varint();
+        if (value > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::runtime_error("Invalid expression file: value out of range");
+        }
+        return static_cast<std::uint32_t>(value);
+    }
+
+    RealNumber scalar() {
+        const auto tag = integer<std::uint8_t>();
+        RealNumber magnitude;
+        switch (tag & ~NEGATIVE) {
+        case Integer:
+            magnitude = static_cast<RealNumber>(varint());
+            break;
+        case Finite: {
+            const std::uint32_t zigzag = varint32();
+            const auto exponent = static_cast<std::int32_t>((zigzag >> 1) ^ (0 - (zigzag & 1)));
+            const auto high = integer<std::uint64_t>();
+            const auto low = varint();
+            magnitude = std::ldexp(static_cast<RealNumber>(high), exponent - 64) +
+                std::ldexp(static_cast<RealNumber>(low), exponent - 128);
+            break;
+        }
+        case Infinity:
+            magnitude = std::numeric_limits<RealNumber>::infinity();
+            break;
+        case NotANumber:
+            magnitude = std::numeric_limits<RealNumber>::quiet_NaN();
+            break;
+        default:
+            throw std::runtime_error("Invalid expression file: bad number");
+        }
+        return (tag & NEGATIVE) ? -magnitude : magnitude;
+    }
+
+    template<typename T>
+    T number();
+
+    bool done() const {
+        return offset == data.size();
+    }
+
+private:
+    std::span<const std::byte> data;
+    std::size_t offset = 0;
+};
+
+// Real numbers of every width share one encoding
+template<typename T>
+T Reader::number() {
+    return static_cast<T>(scalar());
+}
+
+template<>
+ComplexNumber Reader::number<ComplexNumber>() {
+    const RealNumber real = scalar();
+    const RealNumber imag = scalar();
+    return {real, imag};
+}
+
+bool is_unary(const OpCode op) {
+    return op == OpCode::Sin || op == OpCode::Cos || op == OpCode::Ln || op == OpCode::Exp;
+}
+
+}  // namespace
+
+template<typename T>
+void CompiledExpression<T>::serialize(std::ostream& out) const {
+    Writer writer(out);
+    writer.bytes(MAGIC.data(), MAGIC.size());
+    writer.integer(FORMAT_VERSION);
+    writer.integer(static_cast<std::uint8_t>(NUMBER_KIND<T>));
+    writer.integer(std::uint8_t(0));
+    writer.integer(std::uint16_t(0));
+
+    writer.varint(variable_names.size());
+    writer.varint(constant_pool.size());
+    writer.varint(code.size());
+
+    for (const std::string& name : variable_names) {
+        writer.varint(name.size());
+        writer.bytes(name.data(), name.size());
+    }
+    for (const T& value : constant_pool) {
+        writer.number(value);
+    }
+    for (std::uint32_t i = 0; i < code.size(); ++i) {
+        const Instruction& instr = code[i];
+        writer.integer(static_cast<std::uint8_t>(instr.op));
+        if (instr.op == OpCode::Const || instr.op == OpCode::Var) {
+            writer.varint(instr.lhs);
+        } else {
+            writer.varint(i - instr.lhs);
+            if (!is_unary(instr.op)) {
+                writer.varint(i - instr.rhs);
+            }
+        }
+    }
+    if (!out) {
+        throw std::runtime_error("Can not write the expression");
+    }
+}
+
+template<typename T>
+CompiledExpression<T> CompiledExpression<T>::deserialize(std::span<const std::byte> data) {
+    Reader reader(data);
+    if (std::memcmp(reader.bytes(MAGIC.size()), MAGIC.data(), MAGIC.size()) != 0) {
+        throw std::runtime_error("Invalid expression file: bad magic number");
+    }
+    if (const auto version = reader.integer<std::uint32_t>(); version != FORMAT_VERSION) {
+        throw std::runtime_error(std::format("Unsupported expression file version {}", version));
+    }
+    if (reader.integer<std::uint8_t>() != static_cast<std::uint8_t>(NUMBER_KIND<T>)) {
+        throw std::runtime_error("Invalid expression file: stored for another number type");
+    }
+    reader.bytes(3);
+
+    const std::uint32_t variable_count = reader.varint32();
+    const std::uint32_t constant_count = reader.varint32();
+    const std::uint32_t instruction_count = reader.varint32();
+    if (instruction_count == 0) {
+        throw std::runtime_error("Invalid expression file: no instructions");
+    }
+
+    CompiledExpression tape;
+    std::unordered_set<std::string> seen;
+    for (std::uint32_t i = 0; i < variable_count; ++i) {
+        const std::uint32_t length = reader.varint32();
+        const auto* name = reinterpret_cast<const char*>(reader.bytes(length));
+        tape.variable_names.emplace_back(name, length);
+        if (!seen.insert(tape.variable_names.back()).second) {
+            throw std::runtime_error("Invalid expression file: duplicate variable");
+        }
+    }
+    for (std::uint32_t i = 0; i < constant_count; ++i) {
+        tape.constant_pool.push_back(reader.number<T>());
+    }
+
+    // Operands are stored as distances back, so they can only refer to earlier instructions
+    tape.code.reserve(std::min<std::size_t>(instruction_count, data.size()));
+    for (std::uint32_t i = 0; i < instruction_count; ++i) {
+        const auto op = reader.integer<std::uint8_t>();
+        if (op > static_cast<std::uint8_t>(OpCode::Exp)) {
+            throw std::runtime_error("Invalid expression file: bad op code");
+        }
+        Instruction instr{static_cast<OpCode>(op), 0, 0};
+        if (instr.op == OpCode::Const || instr.op == OpCode::Var) {
+            instr.lhs = reader.varint32();
+            if (instr.lhs >= (instr.op == OpCode::Const ? constant_count : variable_count)) {
+                throw std::runtime_error(std::format("Invalid expression file: bad operand in instruction {}", i));
+            }
+        } else {
+            const auto operand = [&] {
+                const std::uint32_t distance = reader.varint32();
+                if (distance == 0 || distance > i) {
+                    throw std::runtime_error(std::format("Invalid expression file: bad operand in instruction {}", i));
+                }
+                return i - distance;
+            };
+            instr.lhs = operand();
+            if (!is_unary(instr.op)) {
+                instr.rhs = operand();
+            }
+        }
+        tape.code.push_back(instr);
+    }
+    if (!reader.done()) {
+        throw std::runtime_error("Invalid expression file: trailing data");
+    }
+
+    tape.registers.resize(tape.code.size());
+    tape.bound_values.resize(tape.variable_names.size());
+    return tape;
+}
+
+template<typename T>
+CompiledExpression<T> CompiledExpression<T>::load(const std::filesystem::path& path) {
+    const MappedFile file(path);
+    return deserialize(file.bytes());
+}
+
+template void CompiledExpression<RealNumber>::serialize(std::ostream&) const;
+template void CompiledExpression<double>::serialize(std::ostream&) const;
+template void CompiledExpression<float>::serialize(std::ostream&) const;
+template void CompiledExpression<ComplexNumber>::serialize(std::ostream&) const;
+template CompiledExpression<RealNumber> CompiledExpression<RealNumber>::deserialize(std::span<const std::byte>);
+template CompiledExpression<double> CompiledExpression<double>::deserialize(std::span<const std::byte>);
+template CompiledExpression<float> CompiledExpression<float>::deserialize(std::span<const std::byte>);
+template CompiledExpression<ComplexNumber> CompiledExpression<ComplexNumber>::deserialize(std::span<const std::byte>);
+template CompiledExpression<RealNumber> CompiledExpression<RealNumber>::load(const std::filesystem::path&);
+template CompiledExpression<double> CompiledExpression<double>::load(const std::filesystem::path&);
+template CompiledExpression<float> CompiledExpression<float>::load(const std::filesystem::path&);
+template CompiledExpression<ComplexNumber> CompiledExpression<ComplexNumber>::load(const std::filesystem::path&);
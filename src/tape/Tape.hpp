@@ -0,0 +1,151 @@
+#ifndef TAPE_HPP
+#define TAPE_HPP
+
+#include "../expressions/expressions.hpp"
+#include "Dual.hpp"
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+/// One step of a compiled expression. Every instruction writes the register with its own index,
+/// so operands always refer to earlier registers.
+///   Const:        lhs is an index into the constant pool
+///   Var:          lhs is a variable slot
+///   Sin/Cos/...:  lhs is the argument register
+///   Add/Sub/...:  lhs and rhs are the operand registers
+struct Instruction {
+    OpCode op;
+    std::uint32_t lhs;
+    std::uint32_t rhs;
+};
+
+template<typename T = RealNumber>
+class CompiledExpression {
+public:
+    T evaluate(std::span<const T> values);
+    T evaluate(const std::unordered_map<std::string, T>& values);
+
+    /// Runs the tape once and writes the registers listed in `outputs` into `out`, for tapes that
+    /// hold several results (registers returned by `TapeBuilder::lower`).
+    void evaluate_outputs(std::span<const T> values, std::span<const std::uint32_t> outputs, std::span<T> out);
+
+    /// Evaluates the expression for every row of `columns` (one column per variable, in `variables()` order).
+    void evaluate_batch(std::span<const std::span<const T>> columns, std::span<T> out);
+    /// Complex tapes only: the same with every column and the output split into separate arrays of real
+    /// and imaginary parts of type `R` (`double` or `float`), so that each operator runs as a kernel
+    /// over plain reals. Constants are rounded to `R`.
+    template<typename R>
+    void evaluate_batch_split(
+        std::span<const std::span<const R>> real_columns,
+        std::span<const std::span<const R>> imag_columns,
+        std::span<R> real_out,
+        std::span<R> imag_out
+    ) requires std::same_as<T, ComplexNumber>;
+
+    /// Reverse mode: one forward and one backward sweep over the tape. Returns the value and writes
+    /// the partial derivative by every variable into `partials`, in `variables()` order.
+    T gradient(std::span<const T> values, std::span<T> partials);
+
+    /// Forward mode: one sweep on dual numbers. Returns the value and the derivative along `direction`
+    /// (one component per variable, in `variables()` order).
+    Dual<T> directional(std::span<const T> values, std::span<const T> direction);
+    /// Returns the value and the derivative by the variable in slot `by`.
+    Dual<T> derivative(std::span<const T> values, std::uint32_t by);
+
+    /// Taylor mode: propagates truncated power series in the variable in slot `by` through the tape.
+    /// Writes the value and the derivatives of orders 1..k into `derivatives`, where k = `derivatives.size() - 1`.
+    /// Costs O(k^2) per instruction.
+    void taylor(std::span<const T> values, std::uint32_t by, std::span<T> derivatives);
+
+    /// Versioned, portable binary form of the tape. Shared subexpressions stay shared: every
+    /// instruction is stored once. Loading validates the data and needs no lexing or parsing.
+    void serialize(std::ostream& out) const;
+    static CompiledExpression deserialize(std::span<const std::byte> data);
+    /// Deserializes a file through a read-only memory mapping.
+    static CompiledExpression load(const std::filesystem::path& path);
+
+    /// Copies the tape with every constant rounded to `U`, so the same program runs at another precision.
+    template<typename U>
+    CompiledExpression<U> convert() const;
+
+    const std::vector<std::string>& variables() const;
+    const std::vector<Instruction>& instructions() const;
+    const std::vector<T>& constants() const;
+    std::size_t size() const;
+
+private:
+    std::vector<Instruction> code;
+    std::vector<T> constant_pool;
+    std::vector<std::string> variable_names;
+
+    std::vector<T> registers;
+    std::vector<T> bound_values;
+
+    std::vector<T> adjoints;
+
+    std::vector<Dual<T>> dual_values;
+    std::vector<Dual<T>> dual_registers;
+
+    std::vector<T> jets;
+    std::vector<T> jet_scratch;
+
+    std::vector<T> batch_registers;
+    std::vector<const T*> batch_operands;
+
+    template<typename R>
+    struct SplitBuffers {
+        std::vector<R> registers;
+        std::vector<const R*> operands;
+    };
+    std::tuple<SplitBuffers<double>, SplitBuffers<float>> split_buffers;
+
+    CompiledExpression() = default;
+
+    void execute(std::span<const T> values);
+
+    template<typename U>
+    void interpret(std::span<const U> values, U* reg) const;
+    // Computes register `index` from the earlier ones; `interpret` runs it for every instruction
+    template<typename U>
+    void step(std::size_t index, std::span<const U> values, U* reg) const;
+    // Loads `values` with zero derivatives into `dual_values`
+    void seed_duals(std::span<const T> values);
+
+    friend class TapeBuilder<T>;
+    friend class IncrementalEvaluator<T>;
+    template<typename> friend class CompiledExpression;
+};
+
+template<typename T = RealNumber>
+class TapeBuilder {
+public:
+    TapeBuilder() = default;
+    /// Fixes the variable slots up front: `bound_variables[i]` gets slot `i`, and any other
+    /// variable met while lowering is an error.
+    explicit TapeBuilder(const std::vector<std::string>& bound_variables);
+
+    std::uint32_t lower(const std::shared_ptr<BaseExpr<T>>& node);
+
+    std::uint32_t emit(OpCode op, std::uint32_t lhs, std::uint32_t rhs = 0);
+    std::uint32_t emit_constant(T value);
+    std::uint32_t emit_variable(const std::string& name);
+
+    CompiledExpression<T> finish();
+
+private:
+    CompiledExpression<T> tape;
+    std::unordered_map<const BaseExpr<T>*, std::uint32_t> lowered;
+    std::unordered_map<std::string, std::uint32_t> variable_slots;
+    bool variables_bound = false;
+};
+
+#endif  // TAPE_HPP
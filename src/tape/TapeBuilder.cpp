@@ -0,0 +1,93 @@
+#include "Tape.hpp"
+
+#include <format>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+template<typename T>
+TapeBuilder<T>::TapeBuilder(const std::vector<std::string>& bound_variables) : variables_bound(true) {
+    for (const std::string& name : bound_variables) {
+        if (!variable_slots.try_emplace(name, static_cast<std::uint32_t>(tape.variable_names.size())).second) {
+            throw std::invalid_argument(std::format("Variable \"{}\" is bound twice", name));
+        }
+        tape.variable_names.push_back(name);
+    }
+}
+
+template<typename T>
+std::uint32_t TapeBuilder<T>::lower(const std::shared_ptr<BaseExpr<T>>& node) {
+    // Subtrees shared by several parents (e.g. by diff rules) are emitted only once
+    if (const auto it = lowered.find(node.get()); it != lowered.end()) {
+        return it->second;
+    }
+
+    // Operands are lowered first, in post-order from an explicit stack, so that `compile` finds them
+    // in `lowered` and a deep graph (e.g. a long sum read from a file) does not recurse
+    std::vector<std::pair<const BaseExpr<T>*, bool>> pending{{node.get(), false}};
+    while (!pending.empty()) {
+        auto& [current, expanded] = pending.back();
+        if (lowered.contains(current)) {
+            pending.pop_back();
+        } else if (!expanded) {
+            expanded = true;
+            const BaseExpr<T>* const operand_node = current;
+            if (const auto* bin_op = dynamic_cast<const BinOp<T>*>(operand_node)) {
+                pending.emplace_back(bin_op->get_rhs().get(), false);
+                pending.emplace_back(bin_op->get_lhs().get(), false);
+            } else if (const auto* func = dynamic_cast<const Func<T>*>(operand_node)) {
+                pending.emplace_back(func->get_argument().get(), false);
+            }
+        } else {
+            const BaseExpr<T>* const ready = current;
+            pending.pop_back();
+            lowered.emplace(ready, ready->compile(*this));
+        }
+    }
+    return lowered.at(node.get());
+}
+
+template<typename T>
+std::uint32_t TapeBuilder<T>::emit(const OpCode op, const std::uint32_t lhs, const std::uint32_t rhs) {
+    tape.code.push_back(Instruction{op, lhs, rhs});
+    return static_cast<std::uint32_t>(tape.code.size() - 1);
+}
+
+template<typename T>
+std::uint32_t TapeBuilder<T>::emit_constant(T value) {
+    tape.constant_pool.push_back(value);
+    return emit(OpCode::Const, static_cast<std::uint32_t>(tape.constant_pool.size() - 1));
+}
+
+template<typename T>
+std::uint32_t TapeBuilder<T>::emit_variable(const std::string& name) {
+    if (variables_bound) {
+        const auto it = variable_slots.find(name);
+        if (it == variable_slots.end()) {
+            throw std::invalid_argument(std::format("Variable \"{}\" is not bound", name));
+        }
+        return emit(OpCode::Var, it->second);
+    }
+
+    auto [it, inserted] = variable_slots.try_emplace(
+        name, static_cast<std::uint32_t>(tape.variable_names.size())
+    );
+    if (inserted) {
+        tape.variable_names.push_back(name);
+    }
+    return emit(OpCode::Var, it->second);
+}
+
+template<typename T>
+CompiledExpression<T> TapeBuilder<T>::finish() {
+    tape.registers.resize(tape.code.size());
+    tape.bound_values.resize(tape.variable_names.size());
+    lowered.clear();
+    variable_slots.clear();
+    return std::move(tape);
+}
+
+template class TapeBuilder<RealNumber>;
+template class TapeBuilder<double>;
+template class TapeBuilder<float>;
+template class TapeBuilder<ComplexNumber>;
@@ -0,0 +1,228 @@
+#include "Tape.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <optional>
+#include <stdexcept>
+
+namespace {
+
+// Exponents up to this are raised by repeated squaring, which also works at a zero base
+constexpr RealNumber MAX_INTEGER_EXPONENT = 1 << 20;
+
+std::optional<std::uint64_t> integer_exponent(const RealNumber value) {
+    if (value >= 0 && value <= MAX_INTEGER_EXPONENT && std::trunc(value) == value) {
+        return static_cast<std::uint64_t>(value);
+    }
+    return std::nullopt;
+}
+
+std::optional<std::uint64_t> integer_exponent(const ComplexNumber value) {
+    if (value.imag() != 0) {
+        return std::nullopt;
+    }
+    return integer_exponent(value.real());
+}
+
+// Truncated series arithmetic on Taylor coefficients c[j] = f^(j) / j!, `n` terms each.
+// `out` must not alias the operands.
+
+template<typename T>
+void series_mul(const T* a, const T* b, T* out, const std::size_t n) {
+    for (std::size_t j = 0; j < n; ++j) {
+        T sum = T(0);
+        for (std::size_t i = 0; i <= j; ++i) {
+            sum += a[i] * b[j - i];
+        }
+        out[j] = sum;
+    }
+}
+
+template<typename T>
+void series_div(const T* a, const T* b, T* out, const std::size_t n) {
+    for (std::size_t j = 0; j < n; ++j) {
+        T sum = a[j];
+        for (std::size_t i = 1; i <= j; ++i) {
+            sum -= b[i] * out[j - i];
+        }
+        out[j] = sum / b[0];
+    }
+}
+
+// exp: c' = a' c
+template<typename T>
+void series_exp(const T* a, T* out, const std::size_t n) {
+    out[0] = std::exp(a[0]);
+    for (std::size_t j = 1; j < n; ++j) {
+        T sum = T(0);
+        for (std::size_t i = 1; i <= j; ++i) {
+            sum += T(i) * a[i] * out[j - i];
+        }
+        out[j] = sum / T(j);
+    }
+}
+
+// ln: a c' = a'
+template<typename T>
+void series_ln(const T* a, T* out, const std::size_t n) {
+    out[0] = std::log(a[0]);
+    for (std::size_t j = 1; j < n; ++j) {
+        T sum = T(j) * a[j];
+        for (std::size_t i = 1; i < j; ++i) {
+            sum -= T(i) * out[i] * a[j - i];
+        }
+        out[j] = sum / (T(j) * a[0]);
+    }
+}
+
+// sin and cos are computed together: s' = a' c, c' = -a' s
+template<typename T>
+void series_sin_cos(const T* a, T* sin_out, T* cos_out, const std::size_t n) {
+    sin_out[0] = std::sin(a[0]);
+    cos_out[0] = std::cos(a[0]);
+    for (std::size_t j = 1; j < n; ++j) {
+        T sin_sum = T(0);
+        T cos_sum = T(0);
+        for (std::size_t i = 1; i <= j; ++i) {
+            sin_sum += T(i) * a[i] * cos_out[j - i];
+            cos_sum += T(i) * a[i] * sin_out[j - i];
+        }
+        sin_out[j] = sin_sum / T(j);
+        cos_out[j] = -cos_sum / T(j);
+    }
+}
+
+// a ^ p for a constant p: a c' = p a' c
+template<typename T>
+void series_pow_constant(const T* a, const T exponent, T* out, const std::size_t n) {
+    out[0] = std::pow(a[0], exponent);
+    for (std::size_t j = 1; j < n; ++j) {
+        T sum = T(0);
+        for (std::size_t i = 1; i <= j; ++i) {
+            sum += (exponent * T(i) - T(j - i)) * a[i] * out[j - i];
+        }
+        out[j] = sum / (T(j) * a[0]);
+    }
+}
+
+// a ^ p for a non-negative integer p by repeated squaring; `scratch` holds 2 * n terms
+template<typename T>
+void series_pow_integer(const T* a, std::uint64_t exponent, T* out, T* scratch, const std::size_t n) {
+    T* const base = scratch;
+    T* const product = scratch + n;
+    std::copy_n(a, n, base);
+    std::fill_n(out, n, T(0));
+    out[0] = T(1);
+    while (exponent != 0) {
+        if (exponent & 1) {
+            series_mul(out, base, product, n);
+            std::copy_n(product, n, out);
+        }
+        exponent >>= 1;
+        if (exponent != 0) {
+            series_mul(base, base, product, n);
+            std::copy_n(product, n, base);
+        }
+    }
+}
+
+}  // namespace
+
+template<typename T>
+void CompiledExpression<T>::taylor(std::span<const T> values, const std::uint32_t by, std::span<T> derivatives) {
+    if (values.size() < variable_names.size()) {
+        throw std::invalid_argument(std::format(
+            "Expected {} variable values, got {}", variable_names.size(), values.size()
+        ));
+    }
+    if (by >= variable_names.size()) {
+        throw std::invalid_argument(std::format(
+            "Variable slot {} is out of range for {} variables", by, variable_names.size()
+        ));
+    }
+    if (derivatives.empty()) {
+        return;
+    }
+
+    const std::size_t n = derivatives.size();
+    jets.assign(code.size() * n, T(0));
+    jet_scratch.resize(2 * n);
+
+    T* const scratch = jet_scratch.data();
+    for (std::size_t i = 0; i < code.size(); ++i) {
+        const Instruction& instr = code[i];
+        T* const out = jets.data() + i * n;
+        const T* const a = jets.data() + instr.lhs * n;
+        const T* const b = jets.data() + instr.rhs * n;
+        switch (instr.op) {
+        case OpCode::Const:
+            out[0] = constant_pool[instr.lhs];
+            break;
+        case OpCode::Var:
+            out[0] = values[instr.lhs];
+            if (instr.lhs == by && n > 1) {
+                out[1] = T(1);
+            }
+            break;
+        case OpCode::Add:
+            for (std::size_t j = 0; j < n; ++j) {
+                out[j] = a[j] + b[j];
+            }
+            break;
+        case OpCode::Sub:
+            for (std::size_t j = 0; j < n; ++j) {
+                out[j] = a[j] - b[j];
+            }
+            break;
+        case OpCode::Mul:
+            series_mul(a, b, out, n);
+            break;
+        case OpCode::Div:
+            series_div(a, b, out, n);
+            break;
+        case OpCode::Pow:
+            // Constant exponents are the common case and need no logarithm (which is undefined for base <= 0)
+            if (code[instr.rhs].op == OpCode::Const) {
+                const T exponent = constant_pool[code[instr.rhs].lhs];
+                if (const auto integer = integer_exponent(exponent)) {
+                    series_pow_integer(a, integer.value(), out, scratch, n);
+                } else {
+                    series_pow_constant(a, exponent, out, n);
+                }
+            } else {
+                // a ^ b = exp(b * ln(a))
+                series_ln(a, scratch, n);
+                series_mul(b, scratch, scratch + n, n);
+                series_exp(scratch + n, out, n);
+            }
+            break;
+        case OpCode::Sin:
+            series_sin_cos(a, out, scratch, n);
+            break;
+        case OpCode::Cos:
+            series_sin_cos(a, scratch, out, n);
+            break;
+        case OpCode::Ln:
+            series_ln(a, out, n);
+            break;
+        case OpCode::Exp:
+            series_exp(a, out, n);
+            break;
+        }
+    }
+
+    const T* const result = jets.data() + (code.size() - 1) * n;
+    T factorial = T(1);
+    for (std::size_t j = 0; j < n; ++j) {
+        if (j > 0) {
+            factorial *= T(j);
+        }
+        derivatives[j] = result[j] * factorial;
+    }
+}
+
+template void CompiledExpression<RealNumber>::taylor(std::span<const RealNumber>, std::uint32_t, std::span<RealNumber>);
+template void CompiledExpression<double>::taylor(std::span<const double>, std::uint32_t, std::span<double>);
+template void CompiledExpression<float>::taylor(std::span<const float>, std::uint32_t, std::span<float>);
+template void CompiledExpression<ComplexNumber>::taylor(std::span<const ComplexNumber>, std::uint32_t, std::span<ComplexNumber>);